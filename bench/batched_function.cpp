@@ -0,0 +1,99 @@
+#include <xaos/batched_function.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+
+template <class F>
+auto measure(char const* name, std::size_t ops, F f) {
+  auto const start = std::chrono::steady_clock::now();
+  f();
+  auto const elapsed = std::chrono::steady_clock::now() - start;
+  auto const ns
+    = std::chrono::duration<double, std::nano>(elapsed).count() / ops;
+  std::printf("%-24s %10zu ops %8.3f ns/op\n", name, ops, ns);
+}
+
+
+struct record {
+  int level;
+  double value;
+};
+
+
+// a sink which has to lock for every call it gets
+struct locked_sink {
+  void add(record const& r) {
+    auto lock = std::lock_guard<std::mutex>(mutex);
+    sum += r.level * r.value;
+  }
+
+  void add(xaos::span<record const> batch) {
+    auto lock = std::lock_guard<std::mutex>(mutex);
+    for (auto const& r : batch) { sum += r.level * r.value; }
+  }
+
+  std::mutex mutex;
+  double sum = 0;
+};
+
+
+template <class F>
+void emit(F& f, std::size_t threads, std::size_t ops) {
+  auto workers = std::vector<std::thread>();
+  for (std::size_t t = 0; t != threads; ++t) {
+    workers.emplace_back([&f, ops, threads] {
+      for (std::size_t i = 0; i != ops / threads; ++i) {
+        f(record{static_cast<int>(i & 3), 0.5});
+      }
+    });
+  }
+  for (auto& w : workers) { w.join(); }
+}
+
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+  auto const ops = argc > 1 ? std::stoul(argv[1]) : 10000000ul;
+  auto const max_threads = std::thread::hardware_concurrency() > 1 ? 4u : 1u;
+
+  for (auto threads = 1u; threads <= max_threads; threads *= 2) {
+    std::printf("%u thread(s)\n", threads);
+    auto sink = locked_sink();
+
+    auto per_call = xaos::function<void(record const&)>(
+      [&](record const& r) { sink.add(r); });
+    measure("function per call", ops, [&] { emit(per_call, threads, ops); });
+
+    for (auto const batch_size : {16u, 256u}) {
+      auto batched = xaos::batched_function<void(record const&)>(
+        [&](xaos::span<record const> batch) { sink.add(batch); },
+        batch_size);
+      auto const name = "batched, " + std::to_string(batch_size);
+      measure(name.c_str(), ops, [&] {
+        emit(batched, threads, ops);
+        batched.flush_all();
+      });
+    }
+
+    auto delayed = xaos::batched_function<void(record const&)>(
+      [&](xaos::span<record const> batch) { sink.add(batch); },
+      256,
+      std::chrono::milliseconds(1));
+    measure("batched, 256, delayed", ops, [&] {
+      emit(delayed, threads, ops);
+      delayed.flush_all();
+    });
+
+    if (sink.sum == 42) { std::puts(""); }
+  }
+}
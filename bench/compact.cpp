@@ -0,0 +1,80 @@
+#include <xaos/arena.hpp>
+#include <xaos/compact.hpp>
+#include <xaos/function.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+
+template <class F>
+auto measure(char const* name, std::size_t ops, F f) {
+  auto const start = std::chrono::steady_clock::now();
+  f();
+  auto const elapsed = std::chrono::steady_clock::now() - start;
+  auto const ns
+    = std::chrono::duration<double, std::nano>(elapsed).count() / ops;
+  std::printf("%-24s %10zu ops %8.3f ns/op\n", name, ops, ns);
+}
+
+
+template <int N>
+struct handler {
+  auto operator()(int x) -> int { return state[x & 3] += x + N; }
+
+  int state[4] = {};
+};
+
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+  auto const size = argc > 1 ? std::stoul(argv[1]) : 1000000ul;
+  auto const rounds = std::size_t(10);
+
+  using alloc_type = xaos::arena_allocator<void>;
+  using F = xaos::function<int(int), alloc_type>;
+
+  // must outlive the table
+  auto arena = xaos::arena(1 << 20);
+
+  // interleave the backends with unrelated allocations and shuffle the table,
+  // so that the backends end up scattered like after many reassignments
+  auto random = std::mt19937(42);
+  auto noise = std::vector<std::unique_ptr<char[]>>();
+  auto table = std::vector<F>();
+  table.reserve(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    switch (random() % 3) {
+    case 0: table.emplace_back(handler<0>()); break;
+    case 1: table.emplace_back(handler<1>()); break;
+    default: table.emplace_back(handler<2>()); break;
+    }
+    noise.emplace_back(new char[16 + random() % 256]);
+  }
+  std::shuffle(table.begin(), table.end(), random);
+  noise.clear();
+
+  auto sum = 0;
+  auto const dispatch = [&] {
+    for (std::size_t r = 0; r < rounds; ++r) {
+      for (auto& f : table) { sum += f(static_cast<int>(r)); }
+    }
+  };
+
+  measure("scattered dispatch", size * rounds, dispatch);
+
+  measure("compact", size, [&] { xaos::compact(table, alloc_type(arena)); });
+
+  measure("compacted dispatch", size * rounds, dispatch);
+
+  return sum == 42 ? 1 : 0;
+}
@@ -0,0 +1,85 @@
+#include <xaos/dispatch_table.hpp>
+#include <xaos/function.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace {
+
+
+template <class F>
+auto measure(char const* name, std::size_t ops, F f) {
+  auto const start = std::chrono::steady_clock::now();
+  f();
+  auto const elapsed = std::chrono::steady_clock::now() - start;
+  auto const ns
+    = std::chrono::duration<double, std::nano>(elapsed).count() / ops;
+  std::printf("%-24s %10zu ops %8.3f ns/op\n", name, ops, ns);
+}
+
+
+auto make_handler(int i) {
+  return [i, state = 0](int x) mutable { return state += x ^ i; };
+}
+
+
+template <class Key>
+void compare(
+  char const* map_name,
+  char const* table_name,
+  std::vector<Key> const& keys,
+  std::size_t messages) {
+  using map_type = std::unordered_map<Key, xaos::function<int(int)>>;
+  using table_type = xaos::dispatch_table<Key, int(int)>;
+
+  auto map = map_type();
+  auto entries = std::vector<typename table_type::entry_type>();
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    map.emplace(keys[i], make_handler(static_cast<int>(i)));
+    entries.emplace_back(keys[i], make_handler(static_cast<int>(i)));
+  }
+  auto table = table_type(std::move(entries));
+
+  auto random = std::mt19937(7);
+  auto pick = std::uniform_int_distribution<std::size_t>(0, keys.size() - 1);
+  auto stream = std::vector<Key const*>();
+  for (std::size_t i = 0; i < messages; ++i) {
+    stream.push_back(&keys[pick(random)]);
+  }
+
+  auto sum = 0;
+  measure(map_name, messages, [&] {
+    for (auto const key : stream) { sum += map.find(*key)->second(1); }
+  });
+  measure(table_name, messages, [&] {
+    for (auto const key : stream) { sum += (*table.find(*key))(1); }
+  });
+  if (sum == 42) { std::puts(""); }
+}
+
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+  auto const messages = argc > 1 ? std::stoul(argv[1]) : 10000000ul;
+
+  auto int_keys = std::vector<int>();
+  for (int i = 0; i < 256; ++i) { int_keys.push_back(i); }
+  compare("unordered_map<int>", "dispatch_table<int>", int_keys, messages);
+
+  auto string_keys = std::vector<std::string>();
+  for (int i = 0; i < 256; ++i) {
+    string_keys.push_back("message.type." + std::to_string(i));
+  }
+  compare(
+    "unordered_map<string>",
+    "dispatch_table<string>",
+    string_keys,
+    messages);
+}
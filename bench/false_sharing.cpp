@@ -0,0 +1,65 @@
+#include <xaos/arena.hpp>
+#include <xaos/function.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+
+template <class F>
+auto measure(char const* name, std::size_t ops, F f) {
+  auto const start = std::chrono::steady_clock::now();
+  f();
+  auto const elapsed = std::chrono::steady_clock::now() - start;
+  auto const ns
+    = std::chrono::duration<double, std::nano>(elapsed).count() / ops;
+  std::printf("%-24s %10zu ops %8.3f ns/op\n", name, ops, ns);
+}
+
+
+// Every thread calls its own function, whose backends were allocated one
+// after another from the same arena.
+template <class Function>
+void run(char const* name, unsigned threads, std::size_t calls) {
+  auto memory = xaos::arena();
+  auto alloc = xaos::arena_allocator<void>(memory);
+  auto functions = std::vector<Function>();
+  for (unsigned i = 0; i != threads; ++i) {
+    functions.emplace_back(
+      [counter = std::size_t(0)]() mutable { return ++counter; }, alloc);
+  }
+
+  measure(name, calls * threads, [&] {
+    auto workers = std::vector<std::thread>();
+    for (auto& f : functions) {
+      workers.emplace_back([&f, calls] {
+        auto sum = std::size_t(0);
+        for (std::size_t i = 0; i != calls; ++i) { sum += f(); }
+        if (sum == 42) { std::puts(""); }
+      });
+    }
+    for (auto& worker : workers) { worker.join(); }
+  });
+}
+
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+  auto const calls = argc > 1 ? std::stoul(argv[1]) : 20000000ul;
+  auto const threads
+    = std::max(2u, std::min(8u, std::thread::hardware_concurrency()));
+  std::printf("%u threads\n", threads);
+
+  using alloc_type = xaos::arena_allocator<void>;
+  run<xaos::function<std::size_t(), alloc_type>>("function", threads, calls);
+  run<xaos::isolated_function<std::size_t(), alloc_type>>(
+    "isolated_function", threads, calls);
+}
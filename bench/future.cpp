@@ -0,0 +1,55 @@
+#include <xaos/future.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <future>
+#include <string>
+
+
+namespace {
+
+
+template <class F>
+auto measure(char const* name, std::size_t ops, F f) {
+  auto const start = std::chrono::steady_clock::now();
+  f();
+  auto const elapsed = std::chrono::steady_clock::now() - start;
+  auto const ns
+    = std::chrono::duration<double, std::nano>(elapsed).count() / ops;
+  std::printf("%-24s %10zu ops %8.3f ns/op\n", name, ops, ns);
+}
+
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+  auto const chains = argc > 1 ? std::stoul(argv[1]) : 1000000ul;
+
+  // a promise with a continuation attached before the value is set, as done
+  // with std::promise and a std::function callback
+  auto sum = 0l;
+  measure("std::promise+function", chains, [&] {
+    for (std::size_t i = 0; i != chains; ++i) {
+      auto p = std::promise<int>();
+      auto f = p.get_future();
+      auto next = std::promise<int>();
+      auto g = next.get_future();
+      auto callback = std::function<void()>(
+        [&f, &next] { next.set_value(f.get() + 1); });
+      p.set_value(static_cast<int>(i));
+      callback();
+      sum += g.get();
+    }
+  });
+  measure("xaos::promise+then", chains, [&] {
+    for (std::size_t i = 0; i != chains; ++i) {
+      auto p = xaos::promise<int>();
+      auto g = p.get_future().then([](int x) { return x + 1; });
+      p.set_value(static_cast<int>(i));
+      sum += g.get();
+    }
+  });
+  if (sum == 42) { std::puts(""); }
+}
@@ -0,0 +1,98 @@
+#include <xaos/function.hpp>
+#include <xaos/inline_cache.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+
+template <class F>
+auto measure(char const* name, std::size_t ops, F f) {
+  auto const start = std::chrono::steady_clock::now();
+  f();
+  auto const elapsed = std::chrono::steady_clock::now() - start;
+  auto const ns
+    = std::chrono::duration<double, std::nano>(elapsed).count() / ops;
+  std::printf("%-24s %10zu ops %8.3f ns/op\n", name, ops, ns);
+}
+
+
+struct add {
+  auto operator()(int x) -> int { return x + value; }
+  int value;
+};
+
+struct multiply {
+  auto operator()(int x) -> int { return x * value; }
+  int value;
+};
+
+struct subtract {
+  auto operator()(int x) -> int { return x - value; }
+  int value;
+};
+
+struct shift {
+  auto operator()(int x) -> int { return x << (value & 7); }
+  int value;
+};
+
+
+using function_type = xaos::function<int(int)>;
+
+auto make_handler(int kind, int value) -> function_type {
+  switch (kind) {
+  case 0: return add{value};
+  case 1: return multiply{value};
+  case 2: return subtract{value};
+  default: return shift{value};
+  }
+}
+
+
+void run(char const* workload, int kinds, std::size_t calls) {
+  auto random = std::mt19937(3);
+  auto pick = std::uniform_int_distribution<int>(0, kinds - 1);
+  auto handlers = std::vector<function_type>();
+  for (int i = 0; i < 1024; ++i) {
+    handlers.push_back(make_handler(pick(random), i));
+  }
+
+  std::printf("%s\n", workload);
+  auto sum = 0;
+  measure("virtual", calls, [&] {
+    for (std::size_t i = 0; i != calls; ++i) {
+      sum += handlers[i % handlers.size()](static_cast<int>(i));
+    }
+  });
+  measure("invoke_as<add>", calls, [&] {
+    for (std::size_t i = 0; i != calls; ++i) {
+      sum += xaos::invoke_as<add>(
+        handlers[i % handlers.size()], static_cast<int>(i));
+    }
+  });
+
+  auto cache = xaos::inline_cache<add, multiply>();
+  measure("inline_cache<add, mul>", calls, [&] {
+    for (std::size_t i = 0; i != calls; ++i) {
+      sum += cache(handlers[i % handlers.size()], static_cast<int>(i));
+    }
+  });
+  std::printf("%-24s %.2f\n", "hit rate", cache.hit_rate());
+  if (sum == 42) { std::puts(""); }
+}
+
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+  auto const calls = argc > 1 ? std::stoul(argv[1]) : 50000000ul;
+  run("monomorphic", 1, calls);
+  run("polymorphic", 4, calls);
+}
@@ -0,0 +1,52 @@
+#include <xaos/function.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <numeric>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+
+template <class F>
+auto measure(char const* name, std::size_t ops, F f) {
+  auto const start = std::chrono::steady_clock::now();
+  f();
+  auto const elapsed = std::chrono::steady_clock::now() - start;
+  auto const ns
+    = std::chrono::duration<double, std::nano>(elapsed).count() / ops;
+  std::printf("%-24s %10zu ops %8.3f ns/op\n", name, ops, ns);
+}
+
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+  auto const size = argc > 1 ? std::stoul(argv[1]) : 1000000ul;
+  auto const rounds = std::size_t(20);
+
+  auto in = std::vector<float>(size);
+  std::iota(in.begin(), in.end(), 0.0f);
+  auto out = std::vector<float>(size);
+
+  // the stored callable depends on input, so that calls are not devirtualized
+  using F = xaos::bulk_function<float(float)>;
+  auto f = argc > 2 ? F([](float x) { return x * 0.25f - 1; })
+                    : F([](float x) { return x * 0.5f + 1; });
+
+  measure("element-wise", size * rounds, [&] {
+    for (std::size_t r = 0; r < rounds; ++r) {
+      for (std::size_t i = 0; i < size; ++i) { out[i] = f(in[i]); }
+    }
+  });
+  auto const check = out[size / 2];
+
+  measure("invoke_bulk", size * rounds, [&] {
+    for (std::size_t r = 0; r < rounds; ++r) { f.invoke_bulk(in, out); }
+  });
+
+  return out[size / 2] == check ? 0 : 1;
+}
@@ -0,0 +1,126 @@
+#include <xaos/poly.hpp>
+
+#include <any>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+
+namespace {
+
+
+template <class F>
+auto measure(char const* name, std::size_t ops, F f) {
+  auto const start = std::chrono::steady_clock::now();
+  f();
+  auto const elapsed = std::chrono::steady_clock::now() - start;
+  auto const ns
+    = std::chrono::duration<double, std::nano>(elapsed).count() / ops;
+  std::printf("%-24s %10zu ops %8.3f ns/op\n", name, ops, ns);
+}
+
+
+struct shape {
+  virtual auto area() const -> double = 0;
+
+  template <class Derived, class Base>
+  struct implementation : Base {
+    auto area() const -> double override {
+      return static_cast<Derived const&>(*this).value().area();
+    }
+  };
+
+protected:
+  ~shape() = default;
+};
+
+struct square {
+  auto area() const -> double { return side * side; }
+  double side;
+};
+
+
+// the classic alternative, the value type derives from the interface
+struct virtual_shape {
+  virtual ~virtual_shape() = default;
+  virtual auto area() const -> double = 0;
+};
+
+struct virtual_square final : virtual_shape {
+  explicit virtual_square(double side) : side(side) {}
+  auto area() const -> double override { return side * side; }
+  double side;
+};
+
+
+using heap_poly = xaos::poly<shape>;
+using inline_poly = xaos::poly<shape, xaos::inline_poly_traits<>>;
+
+
+template <class Handle, class Make, class Area>
+void run(char const* name, std::size_t ops, Make make, Area area) {
+  std::printf("%s\n", name);
+  auto sum = 0.0;
+  measure("create and destroy", ops, [&] {
+    for (std::size_t i = 0; i != ops; ++i) {
+      auto handle = make(static_cast<double>(i & 7));
+      sum += area(handle);
+    }
+  });
+
+  auto handles = std::vector<Handle>();
+  for (int i = 0; i != 1024; ++i) { handles.push_back(make(i)); }
+  measure("call", ops, [&] {
+    for (std::size_t i = 0; i != ops; ++i) {
+      sum += area(handles[i % handles.size()]);
+    }
+  });
+
+  if constexpr (std::is_copy_constructible<Handle>::value) {
+    measure("copy", ops / 10, [&] {
+      for (std::size_t i = 0; i != ops / 10; ++i) {
+        auto copy = handles[i % handles.size()];
+        sum += area(copy);
+      }
+    });
+  }
+  if (sum == 42) { std::puts(""); }
+}
+
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+  auto const ops = argc > 1 ? std::stoul(argv[1]) : 10000000ul;
+
+  run<std::unique_ptr<virtual_shape>>(
+    "unique_ptr<virtual base>",
+    ops,
+    [](double side) -> std::unique_ptr<virtual_shape> {
+      return std::make_unique<virtual_square>(side);
+    },
+    [](auto const& p) { return p->area(); });
+
+  // std::any cannot call anything without knowing the type
+  run<std::any>(
+    "std::any",
+    ops,
+    [](double side) { return std::any(square{side}); },
+    [](auto const& a) { return std::any_cast<square const&>(a).area(); });
+
+  run<heap_poly>(
+    "poly",
+    ops,
+    [](double side) { return heap_poly(square{side}); },
+    [](auto const& p) { return p->area(); });
+
+  run<inline_poly>(
+    "poly, inline",
+    ops,
+    [](double side) { return inline_poly(square{side}); },
+    [](auto const& p) { return p->area(); });
+}
@@ -0,0 +1,99 @@
+#include <xaos/function.hpp>
+#include <xaos/relocate.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+
+template <class F>
+auto measure(char const* name, std::size_t ops, F f) {
+  auto const start = std::chrono::steady_clock::now();
+  f();
+  auto const elapsed = std::chrono::steady_clock::now() - start;
+  auto const ns
+    = std::chrono::duration<double, std::nano>(elapsed).count() / ops;
+  std::printf("%-24s %10zu ops %8.3f ns/op\n", name, ops, ns);
+}
+
+
+// A bare-bones growable array which moves its elements with relocate_n.
+template <class T>
+class relocating_table
+{
+public:
+  relocating_table() = default;
+
+  relocating_table(relocating_table const&) = delete;
+  auto operator=(relocating_table const&) -> relocating_table& = delete;
+
+  ~relocating_table() {
+    for (std::size_t i = 0; i < size_; ++i) { data_[i].~T(); }
+    std::allocator<T>().deallocate(data_, capacity_);
+  }
+
+  template <class... Args>
+  void emplace_back(Args&&... args) {
+    if (size_ == capacity_) {
+      auto const capacity = capacity_ ? capacity_ * 2 : 1;
+      auto const data = std::allocator<T>().allocate(capacity);
+      xaos::relocate_n(data_, size_, data);
+      std::allocator<T>().deallocate(data_, capacity_);
+      data_ = data;
+      capacity_ = capacity;
+    }
+    ::new (static_cast<void*>(data_ + size_)) T(static_cast<Args&&>(args)...);
+    ++size_;
+  }
+
+  void erase(std::size_t n) {
+    data_[n].~T();
+    xaos::relocate_n(data_ + n + 1, size_ - n - 1, data_ + n);
+    --size_;
+  }
+
+  auto operator[](std::size_t n) -> T& { return data_[n]; }
+  auto size() const -> std::size_t { return size_; }
+
+private:
+  T* data_ = nullptr;
+  std::size_t size_ = 0;
+  std::size_t capacity_ = 0;
+};
+
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+  auto const size = argc > 1 ? std::stoul(argv[1]) : 100000ul;
+  auto const erasures = size / 100;
+
+  using F = xaos::function<int(int)>;
+  auto const handler = F([](int n) { return n + 1; });
+
+  auto vec = std::vector<F>();
+  measure("vector growth", size, [&] {
+    for (std::size_t i = 0; i < size; ++i) { vec.emplace_back(handler); }
+  });
+
+  auto table = relocating_table<F>();
+  measure("relocate_n growth", size, [&] {
+    for (std::size_t i = 0; i < size; ++i) { table.emplace_back(handler); }
+  });
+
+  measure("vector erase", erasures, [&] {
+    for (std::size_t i = 0; i < erasures; ++i) { vec.erase(vec.begin()); }
+  });
+
+  measure("relocate_n erase", erasures, [&] {
+    for (std::size_t i = 0; i < erasures; ++i) { table.erase(0); }
+  });
+
+  return vec.size() == table.size() && vec[0](1) == table[0](1) ? 0 : 1;
+}
@@ -0,0 +1,59 @@
+#include <xaos/timer_wheel.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+
+template <class F>
+auto measure(char const* name, std::size_t ops, F f) {
+  auto const start = std::chrono::steady_clock::now();
+  f();
+  auto const elapsed = std::chrono::steady_clock::now() - start;
+  auto const ns
+    = std::chrono::duration<double, std::nano>(elapsed).count() / ops;
+  std::printf("%-24s %10zu ops %8.2f ns/op\n", name, ops, ns);
+}
+
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+  auto const pending = argc > 1 ? std::stoul(argv[1]) : 1000000ul;
+  auto const horizon = std::uint64_t(100000);
+
+  auto rng = std::mt19937_64(1);
+  auto dist = std::uniform_int_distribution<std::uint64_t>(1, horizon);
+  auto delays = std::vector<std::uint64_t>(pending);
+  for (auto& delay : delays) { delay = dist(rng); }
+
+  auto wheel = xaos::timer_wheel<>();
+  auto ids = std::vector<xaos::timer_wheel<>::timer_id>(pending);
+  std::size_t fired = 0;
+
+  measure("insert", pending, [&] {
+    for (std::size_t i = 0; i < pending; ++i) {
+      ids[i] = wheel.schedule(delays[i], [&fired] { ++fired; });
+    }
+  });
+
+  measure("cancel (every other)", pending / 2, [&] {
+    for (std::size_t i = 0; i < pending; i += 2) { wheel.cancel(ids[i]); }
+  });
+
+  measure("reinsert (recycled)", pending / 2, [&] {
+    for (std::size_t i = 0; i < pending; i += 2) {
+      ids[i] = wheel.schedule(delays[i], [&fired] { ++fired; });
+    }
+  });
+
+  measure("expire", pending, [&] { wheel.advance(horizon); });
+
+  std::printf("fired %zu of %zu\n", fired, pending);
+  return fired == pending ? 0 : 1;
+}
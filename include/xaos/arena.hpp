@@ -0,0 +1,146 @@
+#ifndef XAOS_ARENA_HPP
+#define XAOS_ARENA_HPP
+
+
+#include <boost/assert.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+
+namespace xaos {
+
+
+// Monotonic memory resource. Allocations are carved out of large chunks one
+// after another, deallocation does nothing, and all memory is released at
+// once when the arena is destroyed. Not thread-safe.
+class arena
+{
+public:
+  explicit arena(std::size_t chunk_size = 64 * 1024) noexcept
+    : chunk_size_(chunk_size) {}
+
+  arena(arena const&) = delete;
+  auto operator=(arena const&) -> arena& = delete;
+
+  ~arena() { release(); }
+
+  auto allocate(std::size_t size, std::size_t alignment) -> void* {
+    BOOST_ASSERT(alignment && !(alignment & (alignment - 1)));
+    auto const address = reinterpret_cast<std::uintptr_t>(current_);
+    auto const padding = (alignment - address % alignment) % alignment;
+    if (!current_ || padding + size > std::size_t(end_ - current_)) {
+      add_chunk(size + alignment);
+      return allocate(size, alignment);
+    }
+
+    auto const result = current_ + padding;
+    current_ = result + size;
+    allocated_ += size;
+    return result;
+  }
+
+  void deallocate(void*, std::size_t) noexcept {}
+
+  // Frees all chunks. Objects allocated from the arena must already be
+  // destroyed.
+  void release() noexcept {
+    while (chunks_) {
+      auto const next = chunks_->next;
+      ::operator delete(chunks_);
+      chunks_ = next;
+    }
+    current_ = end_ = nullptr;
+    allocated_ = 0;
+  }
+
+  // The number of bytes handed out so far.
+  auto bytes_allocated() const noexcept -> std::size_t { return allocated_; }
+
+private:
+  struct alignas(std::max_align_t) chunk {
+    chunk* next;
+  };
+
+  void add_chunk(std::size_t min_size) {
+    auto const size = std::max(chunk_size_, min_size) + sizeof(chunk);
+    auto const raw = ::operator new(size);
+    chunks_ = ::new (raw) chunk{chunks_};
+    current_ = reinterpret_cast<unsigned char*>(chunks_ + 1);
+    end_ = static_cast<unsigned char*>(raw) + size;
+  }
+
+  std::size_t chunk_size_;
+  chunk* chunks_ = nullptr;
+  unsigned char* current_ = nullptr;
+  unsigned char* end_ = nullptr;
+  std::size_t allocated_ = 0;
+};
+
+
+// Allocates from an arena, or from the free store if no arena was given.
+// The allocator moves along with the objects it allocated, so that moving a
+// new value into an object in an arena does not grow the arena. Copies are
+// allocated from the free store, so that they do not depend on the lifetime
+// of the arena.
+template <class T>
+class arena_allocator
+{
+public:
+  using value_type = T;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  arena_allocator() noexcept = default;
+
+  arena_allocator(arena& resource) noexcept : arena_(&resource) {}
+
+  template <class U>
+  arena_allocator(arena_allocator<U> const& other) noexcept
+    : arena_(other.resource()) {}
+
+  auto allocate(std::size_t n) -> T* {
+    if (!arena_) { return std::allocator<T>().allocate(n); }
+    return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* ptr, std::size_t n) noexcept {
+    if (!arena_) {
+      std::allocator<T>().deallocate(ptr, n);
+    } else {
+      arena_->deallocate(ptr, n * sizeof(T));
+    }
+  }
+
+  auto select_on_container_copy_construction() const noexcept
+    -> arena_allocator {
+    return arena_allocator();
+  }
+
+  auto resource() const noexcept -> arena* { return arena_; }
+
+  template <class U>
+  friend auto operator==(arena_allocator l, arena_allocator<U> r) noexcept
+    -> bool {
+    return l.resource() == r.resource();
+  }
+
+  template <class U>
+  friend auto operator!=(arena_allocator l, arena_allocator<U> r) noexcept
+    -> bool {
+    return !(l == r);
+  }
+
+private:
+  arena* arena_ = nullptr;
+};
+
+
+} // namespace xaos
+
+
+#endif // XAOS_ARENA_HPP
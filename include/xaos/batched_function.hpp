@@ -0,0 +1,277 @@
+#ifndef XAOS_BATCHED_FUNCTION_HPP
+#define XAOS_BATCHED_FUNCTION_HPP
+
+
+#include <xaos/detail/cache_line.hpp>
+#include <xaos/detail/thread_replicas.hpp>
+#include <xaos/function.hpp>
+#include <xaos/span.hpp>
+
+#include <boost/assert.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace xaos {
+namespace detail {
+
+
+template <class... Args>
+struct batch_element {
+  using type = std::tuple<std::decay_t<Args>...>;
+};
+
+template <class Arg>
+struct batch_element<Arg> {
+  using type = std::decay_t<Arg>;
+};
+
+
+} // namespace detail
+
+
+template <class Signature, class Allocator = std::allocator<void>>
+class batched_function;
+
+
+// Coalesces calls into batches. A call stores its arguments in a buffer of
+// the calling thread; the sink is invoked with the whole buffer once it holds
+// batch_size elements or when it is flushed. Calls of the sink are serialized
+// by a lock, so the sink needs no synchronization of its own.
+//
+// Arguments are stored as value_type, which is the decayed argument type for
+// a single argument and a tuple of decayed argument types otherwise.
+//
+// Ordering: elements of a batch are in call order, and calls made by one
+// thread reach the sink in the order they were made. Calls made by different
+// threads are not ordered with respect to each other, and a call is not seen
+// by the sink before the buffer holding it is flushed.
+//
+// A buffer is only delivered on a call once it is full. Partial buffers whose
+// first element was stored at least max_delay ago are delivered by
+// flush_expired, which should be called periodically, for example from a
+// timer. The clock is read once per buffer, when its first element is stored.
+//
+// Calls take no lock. The calling thread takes its buffer out of an atomic
+// slot for the duration of the call and puts it back afterwards. Flushing
+// threads swap a full slot for an empty buffer, and skip slots emptied by a
+// running call, so flushing can run concurrently with calls.
+//
+// If the sink throws, the batch it was given is discarded and the exception
+// propagates to the caller.
+template <class... Args, class Allocator>
+class batched_function<void(Args...), Allocator>
+{
+public:
+  using value_type = typename detail::batch_element<Args...>::type;
+  using sink_type = function<void(span<value_type const>), Allocator>;
+  using allocator_type = typename sink_type::allocator_type;
+  using clock_type = std::chrono::steady_clock;
+
+  // A zero max_delay disables the delay, and then the clock is never read by
+  // calls.
+  batched_function(
+    sink_type sink,
+    std::size_t batch_size,
+    clock_type::duration max_delay = clock_type::duration::zero())
+    : sink_(std::move(sink))
+    , batch_size_(batch_size)
+    , max_delay_(max_delay)
+    , buffers_(buffer_allocator(sink_.get_allocator())) {
+    BOOST_ASSERT(batch_size > 0);
+  }
+
+  batched_function(batched_function const&) = delete;
+  auto operator=(batched_function const&) -> batched_function& = delete;
+
+  // Delivers the remaining elements. Exceptions thrown by the sink are
+  // swallowed; call flush_all beforehand to observe them. Must not run
+  // concurrently with calls.
+  ~batched_function() {
+    try {
+      flush_all();
+    } catch (...) {
+    }
+  }
+
+  void operator()(Args... args) {
+    auto& own = local();
+    auto const held = held_batch(own);
+    auto& elements = *held.current;
+    if (elements.empty() && max_delay_ != clock_type::duration::zero()) {
+      auto const deadline = clock_type::now() + max_delay_;
+      own.deadline.store(
+        deadline.time_since_epoch().count(), std::memory_order_relaxed);
+    }
+
+    elements.emplace_back(static_cast<Args&&>(args)...);
+    if (elements.size() >= batch_size_) { deliver(elements); }
+  }
+
+  // Delivers the elements stored by the calling thread.
+  void flush() {
+    auto& own = local();
+    auto const held = held_batch(own);
+    if (!held.current->empty()) { deliver(*held.current); }
+  }
+
+  // Delivers the elements stored by all threads. Buffers of threads which are
+  // in the middle of a call are left to them.
+  void flush_all() {
+    flush_if([](buffer const&) { return true; });
+  }
+
+  // Delivers the elements of buffers whose first element was stored at least
+  // max_delay ago.
+  void flush_expired() {
+    auto const now = clock_type::now().time_since_epoch().count();
+    flush_if([now](buffer const& b) {
+      return now >= b.deadline.load(std::memory_order_relaxed);
+    });
+  }
+
+  auto batch_size() const noexcept -> std::size_t { return batch_size_; }
+
+  auto max_delay() const noexcept -> clock_type::duration {
+    return max_delay_;
+  }
+
+  auto get_allocator() const -> allocator_type {
+    return sink_.get_allocator();
+  }
+
+private:
+  using element_allocator = typename std::allocator_traits<
+    allocator_type>::template rebind_alloc<value_type>;
+
+  using batch = std::vector<value_type, element_allocator>;
+
+  // Aligned so that calls of different threads do not contend for the cache
+  // line holding the slot.
+  struct alignas(detail::cache_line_size) buffer {
+    explicit buffer(allocator_type const& alloc)
+      : first(element_allocator(alloc)), second(element_allocator(alloc)) {}
+
+    // Empty while the owning thread is in a call.
+    std::atomic<batch*> active{&first};
+    // Handed out by flushing threads, guarded by sink_mutex_.
+    batch* spare = &second;
+    // In ticks of clock_type, zero until the first element is stored.
+    std::atomic<clock_type::rep> deadline{0};
+
+    batch first;
+    batch second;
+  };
+
+  // Takes the active batch of a buffer for the duration of a call.
+  struct held_batch {
+    explicit held_batch(buffer& b)
+      : owner(b)
+      , current(b.active.exchange(nullptr, std::memory_order_acquire)) {
+      BOOST_ASSERT(current);
+    }
+
+    held_batch(held_batch const&) = delete;
+    auto operator=(held_batch const&) -> held_batch& = delete;
+
+    ~held_batch() { owner.active.store(current, std::memory_order_release); }
+
+    buffer& owner;
+    batch* const current;
+  };
+
+  using buffer_allocator =
+    typename std::allocator_traits<allocator_type>::template rebind_alloc<
+      buffer>;
+
+  auto local() -> buffer& {
+    auto& last = detail::last_replica();
+    if (last.owner == owner_.id) {
+      return *static_cast<buffer*>(last.replica);
+    }
+
+    auto& found = find_or_create();
+    last = detail::replica_entry{owner_.id, &found};
+    return found;
+  }
+
+  auto find_or_create() -> buffer& {
+    auto& replicas = detail::thread_replicas();
+    if (auto const found = replicas.find(owner_.id)) {
+      return *static_cast<buffer*>(found);
+    }
+
+    auto lock = std::unique_lock<std::mutex>(buffers_mutex_);
+    auto& created = buffers_.emplace_back(sink_.get_allocator());
+    // before flushing threads can see the buffer
+    created.first.reserve(batch_size_);
+    lock.unlock();
+
+    replicas.insert(owner_.id, &created);
+    return created;
+  }
+
+  // The batch taken from a buffer is delivered before the lock of the sink is
+  // released, so a call cannot deliver the elements stored after it first.
+  // If the sink throws, buffers not yet visited keep their elements.
+  template <class Predicate>
+  void flush_if(Predicate pred) {
+    auto lock = std::lock_guard<std::mutex>(buffers_mutex_);
+    auto sink_lock = std::lock_guard<std::mutex>(sink_mutex_);
+    for (auto& b : buffers_) {
+      auto taken = b.active.load(std::memory_order_relaxed);
+      if (!taken || !pred(b)) { continue; }
+      if (!b.active.compare_exchange_strong(
+            taken,
+            b.spare,
+            std::memory_order_acq_rel,
+            std::memory_order_relaxed)) {
+        continue;
+      }
+
+      b.spare = taken;
+      if (!taken->empty()) { deliver_locked(*taken); }
+    }
+  }
+
+  void deliver(batch& elements) {
+    auto lock = std::lock_guard<std::mutex>(sink_mutex_);
+    deliver_locked(elements);
+  }
+
+  // The lock of the sink is held by the caller.
+  void deliver_locked(batch& elements) {
+    struct clear_guard {
+      ~clear_guard() { elements.clear(); }
+      batch& elements;
+    };
+    auto const guard = clear_guard{elements};
+    sink_(span<value_type const>(elements.data(), elements.size()));
+  }
+
+  detail::replica_owner const owner_;
+  sink_type sink_;
+  std::size_t const batch_size_;
+  clock_type::duration const max_delay_;
+
+  std::mutex sink_mutex_;
+  std::mutex buffers_mutex_;
+  // elements of a deque stay in place when it grows at the end
+  std::deque<buffer, buffer_allocator> buffers_;
+};
+
+
+} // namespace xaos
+
+
+#endif // XAOS_BATCHED_FUNCTION_HPP
@@ -0,0 +1,42 @@
+#ifndef XAOS_COMPACT_HPP
+#define XAOS_COMPACT_HPP
+
+
+#include <xaos/arena.hpp>
+#include <xaos/function.hpp>
+
+#include <cstddef>
+#include <type_traits>
+
+
+namespace xaos {
+
+
+// Relocates the backends of a range of functions into memory obtained from
+// alloc, one after another in the order of the range, and releases the memory
+// they occupied before. Compacting a handler table into a fresh arena places
+// the backends next to each other in dispatch order. Empty (moved from)
+// functions are skipped. Returns the number of relocated backends.
+//
+// If relocating a backend throws, the functions that were already relocated
+// stay in their new memory and the exception propagates.
+template <class Range, class Allocator>
+auto compact(Range& range, Allocator const& alloc) -> std::size_t {
+  auto count = std::size_t(0);
+  for (auto& f : range) {
+    auto& storage = detail::function_access::storage(f);
+    if (!storage) { continue; }
+
+    using allocator_type = typename std::remove_reference_t<
+      decltype(storage)>::allocator_type;
+    storage.reallocate(allocator_type(alloc));
+    ++count;
+  }
+  return count;
+}
+
+
+} // namespace xaos
+
+
+#endif // XAOS_COMPACT_HPP
@@ -0,0 +1,139 @@
+#ifndef XAOS_COMPLETION_HANDLER_HPP
+#define XAOS_COMPLETION_HANDLER_HPP
+
+
+#include <xaos/function.hpp>
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/system_executor.hpp>
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+
+namespace xaos {
+namespace detail {
+
+
+// Hides the allocator_type which handlers export for their associated
+// allocator. Handlers are not constructible with that allocator, so they
+// must not be taken for allocator-aware types.
+template <class Handler>
+struct handler_invoker {
+  template <class... Args>
+  auto operator()(Args&&... args) -> decltype(
+    std::declval<Handler>()(static_cast<Args&&>(args)...)) {
+    return std::move(handler)(static_cast<Args&&>(args)...);
+  }
+
+  Handler handler;
+};
+
+
+} // namespace detail
+
+
+// A type-erased Asio completion handler. The backend is allocated with the
+// associated allocator of the wrapped handler, and the associated allocator
+// and executor are exported again, so that operations composed from stored
+// handlers keep using the memory and the execution context the initiating
+// code asked for. Invoking the handler frees the backend.
+//
+// The associated allocator of a handler has to be convertible to Allocator;
+// make_completion_handler picks the types from the handler.
+template <
+  class Signature,
+  class Executor = boost::asio::system_executor,
+  class Allocator = std::allocator<void>>
+class completion_handler
+{
+private:
+  using function_type = consuming_rfunction<Signature, Allocator>;
+
+public:
+  using executor_type = Executor;
+  using allocator_type = typename function_type::allocator_type;
+
+  template <class Handler>
+  explicit completion_handler(Handler handler)
+    : completion_handler(
+      executor_type(boost::asio::get_associated_executor(handler)),
+      allocator_type(boost::asio::get_associated_allocator(handler)),
+      std::move(handler)) {}
+
+  // fallback is used if the handler has no associated executor
+  template <class Handler>
+  completion_handler(Handler handler, executor_type const& fallback)
+    : completion_handler(
+      boost::asio::get_associated_executor(handler, fallback),
+      allocator_type(boost::asio::get_associated_allocator(handler)),
+      std::move(handler)) {}
+
+  // Not ref-qualified, as Asio invokes handlers as lvalues. Can be called
+  // once.
+  template <class... Args>
+  auto operator()(Args&&... args) -> decltype(
+    std::declval<function_type>()(static_cast<Args&&>(args)...)) {
+    return std::move(function_)(static_cast<Args&&>(args)...);
+  }
+
+  // Whether the handler is still to be invoked.
+  explicit operator bool() const noexcept {
+    return static_cast<bool>(function_);
+  }
+
+  auto get_executor() const noexcept -> executor_type { return executor_; }
+
+  auto get_allocator() const -> allocator_type {
+    return function_.get_allocator();
+  }
+
+private:
+  template <class Handler>
+  completion_handler(
+    executor_type const& executor,
+    allocator_type const& alloc,
+    Handler&& handler)
+    : executor_(executor)
+    , function_(
+        detail::handler_invoker<std::decay_t<Handler>>{
+          static_cast<Handler&&>(handler)},
+        alloc) {}
+
+  executor_type executor_;
+  function_type function_;
+};
+
+
+template <class Signature, class Handler>
+auto make_completion_handler(Handler handler) -> completion_handler<
+  Signature,
+  boost::asio::associated_executor_t<Handler>,
+  boost::asio::associated_allocator_t<Handler>> {
+  using result_type = completion_handler<
+    Signature,
+    boost::asio::associated_executor_t<Handler>,
+    boost::asio::associated_allocator_t<Handler>>;
+  return result_type(std::move(handler));
+}
+
+template <class Signature, class Handler, class Executor>
+auto make_completion_handler(Handler handler, Executor const& fallback)
+  -> completion_handler<
+    Signature,
+    boost::asio::associated_executor_t<Handler, Executor>,
+    boost::asio::associated_allocator_t<Handler>> {
+  using result_type = completion_handler<
+    Signature,
+    boost::asio::associated_executor_t<Handler, Executor>,
+    boost::asio::associated_allocator_t<Handler>>;
+  return result_type(std::move(handler), fallback);
+}
+
+
+} // namespace xaos
+
+
+#endif // XAOS_COMPLETION_HANDLER_HPP
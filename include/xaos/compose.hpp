@@ -0,0 +1,40 @@
+#ifndef XAOS_COMPOSE_HPP
+#define XAOS_COMPOSE_HPP
+
+
+#include <xaos/detail/composition.hpp>
+
+
+namespace xaos {
+
+
+template <class First, class Second>
+auto then(First first, Second second)
+  -> detail::composition<First, Second> {
+  return {std::move(first), std::move(second)};
+}
+
+
+template <class Callable>
+auto compose(Callable callable) -> Callable {
+  return callable;
+}
+
+template <class Outer, class Inner, class... Rest>
+auto compose(Outer outer, Inner inner, Rest... rest) {
+  return then(
+    compose(std::move(inner), std::move(rest)...), std::move(outer));
+}
+
+
+template <class Callable, class... Bound>
+auto bind_front(Callable callable, Bound... bound)
+  -> detail::front_binder<Callable, Bound...> {
+  return {std::move(callable), std::move(bound)...};
+}
+
+
+} // namespace xaos
+
+
+#endif // XAOS_COMPOSE_HPP
@@ -2,8 +2,14 @@
 #define XAOS_DETAIL_BACKEND_ALLOC_HPP
 
 
+#include <boost/assert.hpp>
 #include <boost/core/pointer_traits.hpp>
 
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+
 
 namespace xaos {
 namespace detail {
@@ -26,6 +32,35 @@ protected:
 };
 
 
+// Backends of thin handles store their allocator themselves.
+struct thin_interface {
+  virtual auto allocator_address() const noexcept -> void const* = 0;
+
+protected:
+  ~thin_interface() = default;
+};
+
+
+// Backends stored in the buffer of a handle are moved, copied and destroyed
+// in place instead of being allocated. The allocator passed on is the one of
+// the receiving handle.
+struct inline_interface {
+  virtual auto move_inline(void* buffer, void* alloc) noexcept -> void* = 0;
+  virtual void destroy_inline() noexcept = 0;
+
+protected:
+  ~inline_interface() = default;
+};
+
+
+struct inline_clone_interface {
+  virtual auto clone_inline(void* buffer, void* alloc) const -> void* = 0;
+
+protected:
+  ~inline_clone_interface() = default;
+};
+
+
 template <class Allocator, class T>
 auto restore_allocator(void* type_erased_alloc) {
   using proto_traits = std::allocator_traits<Allocator>;
@@ -37,11 +72,39 @@ auto restore_allocator(void* type_erased_alloc) {
 }
 
 
+// Constructs an object passing it the allocator if the object is
+// allocator-aware, following the uses-allocator construction protocol.
+template <class T, class Allocator, class... Args>
+auto make_using_allocator(Allocator const& alloc, Args&&... args) -> T {
+  if constexpr (!std::uses_allocator<T, Allocator>::value) {
+    return T(static_cast<Args&&>(args)...);
+  } else if constexpr (std::is_constructible<
+                         T,
+                         std::allocator_arg_t,
+                         Allocator const&,
+                         Args&&...>::value) {
+    return T(std::allocator_arg, alloc, static_cast<Args&&>(args)...);
+  } else {
+    static_assert(
+      std::is_constructible<T, Args&&..., Allocator const&>::value,
+      "allocator-aware type is not constructible with an allocator");
+    return T(static_cast<Args&&>(args)..., alloc);
+  }
+}
+
+
 template <class Allocator, class... Args>
 auto new_backend(Allocator& alloc, Args&&... args) {
   using traits = std::allocator_traits<Allocator>;
   auto fancy_ptr = traits::allocate(alloc, 1);
   auto const raw_ptr = boost::to_address(fancy_ptr);
+  // over-aligned backends, like isolated ones, rely on the allocator
+  // honouring the alignment of the type it is rebound to
+  BOOST_ASSERT_MSG(
+    reinterpret_cast<std::uintptr_t>(raw_ptr)
+        % alignof(typename traits::value_type)
+      == 0,
+    "the allocator does not honour the alignment of the backend");
   try {
     traits::construct(
       alloc, raw_ptr, std::move(fancy_ptr), static_cast<Args&&>(args)...);
@@ -56,10 +119,13 @@ auto new_backend(Allocator& alloc, Args&&... args) {
 template <class Derived, class Base>
 struct clone_implementation : Base {
   auto clone(void* type_erased_alloc) const -> void* override {
-    auto alloc = restore_allocator<typename Derived::allocator_type, Derived>(
-      type_erased_alloc);
+    using proto_allocator = typename Derived::allocator_type;
+    auto alloc
+      = restore_allocator<proto_allocator, Derived>(type_erased_alloc);
+    auto const& proto_alloc
+      = *static_cast<proto_allocator const*>(type_erased_alloc);
     auto& self = static_cast<Derived const&>(*this);
-    auto const raw_ptr = new_backend(alloc, self.callable());
+    auto const raw_ptr = new_backend(alloc, proto_alloc, self.value());
     return static_cast<typename Derived::interface_type*>(raw_ptr);
   }
 
@@ -68,6 +134,60 @@ protected:
 };
 
 
+template <class Derived, class Base>
+struct thin_implementation : Base {
+  auto allocator_address() const noexcept -> void const* override {
+    auto& self = static_cast<Derived const&>(*this);
+    return std::addressof(self.stored_allocator());
+  }
+
+protected:
+  ~thin_implementation() = default;
+};
+
+
+// Inline backends are built with a null pointer, they are never deallocated.
+template <class Derived, class Base>
+struct inline_implementation : Base {
+  auto move_inline(void* buffer, void* type_erased_alloc) noexcept
+    -> void* override {
+    using proto_allocator = typename Derived::allocator_type;
+    auto const& proto_alloc
+      = *static_cast<proto_allocator const*>(type_erased_alloc);
+    auto& self = static_cast<Derived&>(*this);
+    auto const raw_ptr
+      = ::new (buffer) Derived(nullptr, proto_alloc, std::move(self.value()));
+    self.~Derived();
+    return static_cast<typename Derived::interface_type*>(raw_ptr);
+  }
+
+  void destroy_inline() noexcept override {
+    static_cast<Derived&>(*this).~Derived();
+  }
+
+protected:
+  ~inline_implementation() = default;
+};
+
+
+template <class Derived, class Base>
+struct inline_clone_implementation : Base {
+  auto clone_inline(void* buffer, void* type_erased_alloc) const
+    -> void* override {
+    using proto_allocator = typename Derived::allocator_type;
+    auto const& proto_alloc
+      = *static_cast<proto_allocator const*>(type_erased_alloc);
+    auto& self = static_cast<Derived const&>(*this);
+    auto const raw_ptr
+      = ::new (buffer) Derived(nullptr, proto_alloc, self.value());
+    return static_cast<typename Derived::interface_type*>(raw_ptr);
+  }
+
+protected:
+  ~inline_clone_implementation() = default;
+};
+
+
 } // namespace detail
 } // namespace xaos
 
@@ -3,17 +3,57 @@
 
 
 #include <xaos/detail/backend_alloc.hpp>
+#include <xaos/detail/function_alloc.hpp>
 
+#include <boost/assert.hpp>
 #include <boost/core/empty_value.hpp>
+#include <boost/mp11/function.hpp>
 #include <boost/mp11/integral.hpp>
+#include <boost/mp11/utility.hpp>
 
+#include <cstddef>
 #include <memory>
+#include <type_traits>
 
 
 namespace xaos {
 namespace detail {
 
 
+// Converts the address of a backend into the pointer type the handle keeps
+// it by.
+template <class Pointer, class T>
+auto pointer_from_address(T* raw_ptr) -> Pointer {
+  if constexpr (std::is_pointer<Pointer>::value) {
+    return raw_ptr;
+  } else {
+    return std::pointer_traits<Pointer>::pointer_to(*raw_ptr);
+  }
+}
+
+// Takes ownership of a backend returned by clone or relocate.
+template <class BackendPtr>
+auto adopt_backend(
+  void* impl_ptr,
+  typename BackendPtr::deleter_type::allocator_type const& alloc)
+  -> BackendPtr {
+  using deleter_type = typename BackendPtr::deleter_type;
+  using backend_interface = typename BackendPtr::element_type;
+  auto const iface_ptr = static_cast<backend_interface*>(impl_ptr);
+  return BackendPtr(
+    pointer_from_address<typename BackendPtr::pointer>(iface_ptr),
+    deleter_type(alloc));
+}
+
+
+template <class BackendPtr>
+auto copy_construct_stored(
+  BackendPtr const& backend,
+  typename BackendPtr::deleter_type::allocator_type alloc) -> BackendPtr {
+  auto const void_ptr = backend->clone(std::addressof(alloc));
+  return adopt_backend<BackendPtr>(void_ptr, alloc);
+}
+
 template <class BackendPtr>
 auto copy_construct_stored(BackendPtr const& backend) -> BackendPtr {
   auto const deleter = backend.get_deleter();
@@ -21,13 +61,10 @@ auto copy_construct_stored(BackendPtr const& backend) -> BackendPtr {
   using deleter_type = typename BackendPtr::deleter_type;
   using allocator_type = typename deleter_type::allocator_type;
   using allocator_traits = std::allocator_traits<allocator_type>;
-  auto alloc = allocator_traits::select_on_container_copy_construction(
-    deleter.get_allocator());
-
-  using backend_interface = typename BackendPtr::element_type;
-  auto const void_ptr = backend->clone(std::addressof(alloc));
-  auto const iface_ptr = static_cast<backend_interface*>(void_ptr);
-  return BackendPtr(iface_ptr, deleter_type(alloc));
+  return copy_construct_stored(
+    backend,
+    allocator_traits::select_on_container_copy_construction(
+      deleter.get_allocator(backend.get())));
 }
 
 
@@ -44,22 +81,19 @@ auto pick_allocator(
 }
 
 
-template <
-  class Allocator,
-  std::enable_if_t<
-    std::allocator_traits<Allocator>::propagate_on_container_swap::value,
-    int> = 0>
-auto swap_allocators(Allocator& l, Allocator& r) {
-  using std::swap;
-  swap(l, r);
-}
+// Moving or swapping backends never needs to relocate them, if the
+// allocators either always compare equal or are propagated along with the
+// backends.
+template <class Allocator>
+using is_nothrow_move_assignable_with = boost::mp11::mp_bool<
+  std::allocator_traits<Allocator>::is_always_equal::value
+  || std::allocator_traits<
+    Allocator>::propagate_on_container_move_assignment::value>;
 
-template <
-  class Allocator,
-  std::enable_if_t<
-    !std::allocator_traits<Allocator>::propagate_on_container_swap::value,
-    int> = 0>
-void swap_allocators(Allocator const&, Allocator const&) {}
+template <class Allocator>
+using is_nothrow_swappable_with = boost::mp11::mp_bool<
+  std::allocator_traits<Allocator>::is_always_equal::value
+  || std::allocator_traits<Allocator>::propagate_on_container_swap::value>;
 
 
 template <class Allocator>
@@ -71,10 +105,16 @@ struct backend_deleter : boost::empty_value<Allocator> {
   backend_deleter(Allocator alloc)
     : boost::empty_value<Allocator>(boost::empty_init_t(), std::move(alloc)) {}
 
+  static constexpr bool holds_allocator = true;
+
   auto get_allocator() const -> allocator_type {
     return boost::empty_value<Allocator>::get();
   }
 
+  auto get_allocator(alloc_interface const*) const -> allocator_type {
+    return get_allocator();
+  }
+
   void operator()(alloc_interface* ptr) {
     auto alloc = get_allocator();
     ptr->delete_this(std::addressof(alloc));
@@ -82,88 +122,205 @@ struct backend_deleter : boost::empty_value<Allocator> {
 };
 
 
-template <class BackendInterface, class Allocator, class Callable>
-struct function_backend;
+// Takes the allocator from the backend instead of holding a copy, so that
+// a handle is a single pointer. Thin handles cannot supply an allocator after
+// they have been moved from.
+template <class Allocator>
+struct thin_backend_deleter {
+  static_assert(std::is_void<typename Allocator::value_type>::value);
+
+  using allocator_type = Allocator;
+
+  static constexpr bool holds_allocator = false;
+
+  thin_backend_deleter(Allocator const&) noexcept {}
+
+  template <class Backend>
+  auto get_allocator(Backend const* ptr) const -> allocator_type {
+    BOOST_ASSERT(ptr);
+    return *static_cast<Allocator const*>(ptr->allocator_address());
+  }
+
+  template <class Backend>
+  void operator()(Backend* ptr) {
+    auto alloc = get_allocator(ptr);
+    ptr->delete_this(std::addressof(alloc));
+  }
+};
 
-template <class Result, class Allocator, class Callable>
-auto make_backend(Allocator& proto_alloc, Callable callable) -> Result {
+
+// The pointer type of the allocator can only be kept by handles if it can be
+// null and can be obtained from the address of a backend.
+template <class Pointer>
+using is_handle_pointer = boost::mp11::mp_and<
+  has_pointer_to<Pointer>,
+  std::is_default_constructible<Pointer>,
+  std::is_constructible<Pointer, std::nullptr_t>>;
+
+template <class Allocator, class Element>
+using handle_pointer_candidate = typename std::pointer_traits<
+  typename std::allocator_traits<Allocator>::void_pointer>::
+  template rebind<Element>;
+
+template <class Allocator, class Element>
+using handle_pointer = boost::mp11::mp_if<
+  is_handle_pointer<handle_pointer_candidate<Allocator, Element>>,
+  handle_pointer_candidate<Allocator, Element>,
+  Element*>;
+
+
+// Makes handles keep their backends by the pointer type of the allocator
+// rather than by raw pointers. With offset pointers a handle and its backend
+// can be placed in memory mapped at different addresses by different
+// processes.
+template <class Deleter, class Element>
+struct fancy_pointer_deleter : Deleter {
+  using allocator_type = typename Deleter::allocator_type;
+  using pointer = handle_pointer<allocator_type, Element>;
+
+  using Deleter::Deleter;
+  using Deleter::get_allocator;
+
+  auto get_allocator(pointer const& ptr) const -> allocator_type {
+    return Deleter::get_allocator(boost::to_address(ptr));
+  }
+
+  void operator()(pointer ptr) { Deleter::operator()(boost::to_address(ptr)); }
+};
+
+
+template <class BackendInterface, class Allocator, class Value>
+struct poly_backend;
+
+template <class Result, class Allocator, class Value>
+auto make_backend(Allocator& proto_alloc, Value value) -> Result {
   using deleter_type = typename Result::deleter_type;
   using backend_interface = typename Result::element_type;
-  using backend = function_backend<backend_interface, Allocator, Callable>;
+  using backend = poly_backend<backend_interface, Allocator, Value>;
   using allocator_traits =
     typename std::allocator_traits<Allocator>::template rebind_traits<backend>;
   using allocator_type = typename allocator_traits::allocator_type;
   auto alloc = allocator_type(proto_alloc);
-  auto const raw_ptr = new_backend(alloc, callable);
-  return Result(raw_ptr, deleter_type(proto_alloc));
+  auto const raw_ptr = new_backend(alloc, proto_alloc, std::move(value));
+  auto const iface_ptr = static_cast<backend_interface*>(raw_ptr);
+  return Result(
+    pointer_from_address<typename Result::pointer>(iface_ptr),
+    deleter_type(proto_alloc));
 }
 
 
-template <class BackendBase, class Allocator>
+template <
+  class BackendBase,
+  class Allocator,
+  class Deleter = backend_deleter<Allocator>>
 class backend_pointer
 {
 public:
   using backend_interface = BackendBase;
-  using deleter_type = backend_deleter<Allocator>;
+  using deleter_type = fancy_pointer_deleter<Deleter, backend_interface>;
   using allocator_type = typename deleter_type::allocator_type;
   using stored_ptr = std::unique_ptr<backend_interface, deleter_type>;
+  using pointer = typename stored_ptr::pointer;
 
   template <class... Args>
   backend_pointer(allocator_type alloc, Args... args)
-    : backend_pointer(make_backend<stored_ptr>(alloc, args...)) {}
+    : backend_pointer(make_backend<stored_ptr>(alloc, std::move(args)...)) {}
 
   backend_pointer(backend_pointer&& other) noexcept = default;
 
-  auto operator=(backend_pointer&& other) -> backend_pointer& {
-    using allocator_traits = std::allocator_traits<allocator_type>;
-    auto alloc = pick_allocator(
-      other.get_allocator(),
-      get_allocator(),
-      boost::mp11::mp_bool<
-        allocator_traits::propagate_on_container_move_assignment::value>());
-
-    if (alloc != other.get_allocator()) {
-      auto const impl_ptr = other.stored_->relocate(std::addressof(alloc));
-      auto const iface_ptr = static_cast<backend_interface*>(impl_ptr);
-      this->stored_ = stored_ptr(iface_ptr, deleter_type(alloc));
+  // Moves the backend into memory obtained from alloc unless the allocators
+  // are equal.
+  backend_pointer(
+    std::allocator_arg_t, allocator_type alloc, backend_pointer&& other)
+    : stored_(pointer(), deleter_type(alloc)) {
+    if (!other.stored_) { return; }
+
+    if (other.get_allocator() == alloc) {
+      stored_.reset(other.stored_.release());
     } else {
+      stored_.reset(other.relocated(alloc));
+      other.stored_.reset();
+    }
+  }
+
+  // Allocators that do not propagate are never assigned, they may not even
+  // be assignable.
+  auto operator=(backend_pointer&& other) noexcept(
+    !deleter_type::holds_allocator
+    || is_nothrow_move_assignable_with<allocator_type>::value)
+    -> backend_pointer& {
+    using allocator_traits = std::allocator_traits<allocator_type>;
+    // the allocator of a thin handle always follows its backend
+    if constexpr (
+      !deleter_type::holds_allocator
+      || allocator_traits::propagate_on_container_move_assignment::value) {
       this->stored_ = std::move(other.stored_);
+    } else if constexpr (allocator_traits::is_always_equal::value) {
+      this->stored_.reset(other.stored_.release());
+    } else {
+      if (!other.stored_) {
+        this->stored_.reset();
+      } else if (get_allocator() != other.get_allocator()) {
+        this->stored_.reset(other.relocated(get_allocator()));
+        other.stored_.reset();
+      } else {
+        this->stored_.reset(other.stored_.release());
+      }
     }
 
     return *this;
   }
 
-  void swap(backend_pointer& other) {
-    auto this_alloc = get_allocator();
-    auto other_alloc = other.get_allocator();
-    swap_allocators(this_alloc, other_alloc);
-
-    if (other_alloc != this_alloc) {
-      auto const other_impl_ptr
-        = other.stored_->relocate(std::addressof(other_alloc));
-      auto const other_iface_ptr
-        = static_cast<backend_interface*>(other_impl_ptr);
-      auto other_stored
-        = stored_ptr(other_iface_ptr, deleter_type(other_alloc));
-
-      auto const this_impl_ptr = stored_->relocate(std::addressof(this_alloc));
-      auto const this_iface_ptr
-        = static_cast<backend_interface*>(this_impl_ptr);
-      other.stored_ = stored_ptr(this_iface_ptr, deleter_type(this_alloc));
-
-      stored_ = std::move(other_stored);
-    } else {
-      using std::swap;
+  void swap(backend_pointer& other) noexcept(
+    !deleter_type::holds_allocator
+    || is_nothrow_swappable_with<allocator_type>::value) {
+    using std::swap;
+    if constexpr (
+      !deleter_type::holds_allocator
+      || is_nothrow_swappable_with<allocator_type>::value) {
       swap(this->stored_, other.stored_);
+    } else {
+      auto this_alloc = get_allocator();
+      auto other_alloc = other.get_allocator();
+
+      if (other_alloc != this_alloc) {
+        auto other_stored = other.stored_
+          ? adopt_backend<stored_ptr>(
+            other.stored_->relocate(std::addressof(other_alloc)), other_alloc)
+          : stored_ptr(pointer(), deleter_type(other_alloc));
+        auto this_stored = stored_
+          ? adopt_backend<stored_ptr>(
+            stored_->relocate(std::addressof(this_alloc)), this_alloc)
+          : stored_ptr(pointer(), deleter_type(this_alloc));
+
+        other.stored_ = std::move(this_stored);
+        stored_ = std::move(other_stored);
+      } else {
+        swap_pointers(other);
+      }
     }
   }
 
   auto get_allocator() const -> allocator_type {
-    return stored_.get_deleter().get_allocator();
+    return stored_.get_deleter().get_allocator(stored_.get());
   }
 
-  auto operator->() -> backend_interface* { return stored_.get(); }
-  auto operator->() const -> backend_interface const* { return stored_.get(); }
+  // Moves the backend into memory obtained from alloc and releases the memory
+  // it used to occupy.
+  void reallocate(allocator_type alloc) {
+    BOOST_ASSERT(stored_);
+    auto const impl_ptr = stored_->relocate(std::addressof(alloc));
+    stored_ = adopt_backend<stored_ptr>(impl_ptr, alloc);
+  }
+
+  auto empty() const noexcept -> bool { return !stored_; }
+
+  auto operator->() -> backend_interface* {
+    return boost::to_address(stored_.get());
+  }
+  auto operator->() const -> backend_interface const* {
+    return boost::to_address(stored_.get());
+  }
 
   auto operator*() -> backend_interface& { return *operator->(); }
   auto operator*() const -> backend_interface const& { return *operator->(); }
@@ -171,15 +328,32 @@ public:
 protected:
   backend_pointer(stored_ptr stored) : stored_(std::move(stored)) {}
 
+  // A copy of the backend in memory obtained from alloc.
+  auto relocated(allocator_type alloc) -> pointer {
+    auto const impl_ptr = stored_->relocate(std::addressof(alloc));
+    auto const iface_ptr = static_cast<backend_interface*>(impl_ptr);
+    return pointer_from_address<pointer>(iface_ptr);
+  }
+
+  void swap_pointers(backend_pointer& other) noexcept {
+    auto const ptr = stored_.release();
+    stored_.reset(other.stored_.release());
+    other.stored_.reset(ptr);
+  }
+
   stored_ptr stored_;
 };
 
 
-template <class BackendBase, class Allocator>
-class copyable_backend_pointer : public backend_pointer<BackendBase, Allocator>
+template <
+  class BackendBase,
+  class Allocator,
+  class Deleter = backend_deleter<Allocator>>
+class copyable_backend_pointer
+  : public backend_pointer<BackendBase, Allocator, Deleter>
 {
 private:
-  using base_t = backend_pointer<BackendBase, Allocator>;
+  using base_t = backend_pointer<BackendBase, Allocator, Deleter>;
 
 public:
   using allocator_type = typename base_t::allocator_type;
@@ -195,21 +369,36 @@ public:
   copyable_backend_pointer(copyable_backend_pointer const& other)
     : base_t(copy_construct_stored(other.stored_)) {}
 
+  // spelled out, the inherited one loses against the copying one below
+  copyable_backend_pointer(
+    std::allocator_arg_t,
+    allocator_type alloc,
+    copyable_backend_pointer&& other)
+    : base_t(std::allocator_arg, std::move(alloc), std::move(other)) {}
+
+  copyable_backend_pointer(
+    std::allocator_arg_t,
+    allocator_type alloc,
+    copyable_backend_pointer const& other)
+    : base_t(copy_construct_stored(other.stored_, alloc)) {}
+
   auto operator=(copyable_backend_pointer const& other)
     -> copyable_backend_pointer& {
     using allocator_traits = std::allocator_traits<allocator_type>;
-    auto alloc = pick_allocator(
-      other.get_allocator(),
-      this->get_allocator(),
-      boost::mp11::mp_bool<
-        allocator_traits::propagate_on_container_copy_assignment::value>());
-
-    auto const impl_ptr = other.stored_->clone(std::addressof(alloc));
-
-    using backend_interface = typename base_t::backend_interface;
-    auto const iface_ptr = static_cast<backend_interface*>(impl_ptr);
+    using propagate = boost::mp11::mp_bool<
+      allocator_traits::propagate_on_container_copy_assignment::value>;
+    auto alloc = other.get_allocator();
+    // a moved from thin handle has no allocator of its own
+    if (deleter_type::holds_allocator || this->stored_) {
+      alloc = pick_allocator(alloc, this->get_allocator(), propagate());
+    }
 
-    this->stored_ = stored_ptr(iface_ptr, deleter_type(alloc));
+    auto copy = copy_construct_stored(other.stored_, alloc);
+    if constexpr (deleter_type::holds_allocator && propagate::value) {
+      this->stored_ = std::move(copy);
+    } else {
+      this->stored_.reset(copy.release());
+    }
 
     return *this;
   }
@@ -0,0 +1,21 @@
+#ifndef XAOS_DETAIL_CACHE_LINE_HPP
+#define XAOS_DETAIL_CACHE_LINE_HPP
+
+
+#include <cstddef>
+
+
+namespace xaos {
+namespace detail {
+
+
+// Objects written by different threads are kept this far apart to avoid
+// false sharing.
+constexpr std::size_t cache_line_size = 64;
+
+
+} // namespace detail
+} // namespace xaos
+
+
+#endif // XAOS_DETAIL_CACHE_LINE_HPP
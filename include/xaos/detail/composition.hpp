@@ -0,0 +1,180 @@
+#ifndef XAOS_DETAIL_COMPOSITION_HPP
+#define XAOS_DETAIL_COMPOSITION_HPP
+
+
+#include <boost/core/empty_value.hpp>
+
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+
+namespace xaos {
+namespace detail {
+
+
+template <class First, class Second>
+class composition;
+
+template <class Callable, class... Bound>
+class front_binder;
+
+
+// Provides then and bind_front to callables. Both produce a concrete callable
+// type that stores the stages by value, so wrapping the result in a
+// basic_function results in a single backend holding the whole chain.
+template <class Derived>
+struct composable {
+  template <class Next>
+  auto then(Next next) const& -> composition<Derived, Next> {
+    return {static_cast<Derived const&>(*this), std::move(next)};
+  }
+
+  template <class Next>
+  auto then(Next next) && -> composition<Derived, Next> {
+    return {static_cast<Derived&&>(*this), std::move(next)};
+  }
+
+  template <class... Bound>
+  auto bind_front(Bound... bound) const& -> front_binder<Derived, Bound...> {
+    return {static_cast<Derived const&>(*this), std::move(bound)...};
+  }
+
+  template <class... Bound>
+  auto bind_front(Bound... bound) && -> front_binder<Derived, Bound...> {
+    return {static_cast<Derived&&>(*this), std::move(bound)...};
+  }
+
+protected:
+  ~composable() = default;
+};
+
+
+template <class First, class Second, class... Args>
+auto invoke_composed(First&& first, Second&& second, Args&&... args)
+  -> decltype(auto) {
+  using intermediate = std::invoke_result_t<First, Args...>;
+  if constexpr (std::is_void<intermediate>::value) {
+    std::invoke(static_cast<First&&>(first), static_cast<Args&&>(args)...);
+    return std::invoke(static_cast<Second&&>(second));
+  } else {
+    return std::invoke(
+      static_cast<Second&&>(second),
+      std::invoke(static_cast<First&&>(first), static_cast<Args&&>(args)...));
+  }
+}
+
+
+template <class First, class Second>
+class composition
+  : public composable<composition<First, Second>>
+  , private boost::empty_value<First, 0>
+  , private boost::empty_value<Second, 1>
+{
+private:
+  using first_holder = boost::empty_value<First, 0>;
+  using second_holder = boost::empty_value<Second, 1>;
+
+public:
+  composition(First first, Second second)
+    : first_holder(boost::empty_init_t(), std::move(first))
+    , second_holder(boost::empty_init_t(), std::move(second)) {}
+
+  template <class... Args>
+  auto operator()(Args&&... args) & -> decltype(auto) {
+    return invoke_composed(
+      first_holder::get(), second_holder::get(), static_cast<Args&&>(args)...);
+  }
+
+  template <class... Args>
+  auto operator()(Args&&... args) const& -> decltype(auto) {
+    return invoke_composed(
+      first_holder::get(), second_holder::get(), static_cast<Args&&>(args)...);
+  }
+
+  template <class... Args>
+  auto operator()(Args&&... args) && -> decltype(auto) {
+    return invoke_composed(
+      std::move(first_holder::get()),
+      std::move(second_holder::get()),
+      static_cast<Args&&>(args)...);
+  }
+
+  template <class... Args>
+  auto operator()(Args&&... args) const&& -> decltype(auto) {
+    return invoke_composed(
+      std::move(first_holder::get()),
+      std::move(second_holder::get()),
+      static_cast<Args&&>(args)...);
+  }
+};
+
+
+template <class Callable, class Tuple, std::size_t... I, class... Args>
+auto invoke_bound(
+  Callable&& callable,
+  Tuple&& bound,
+  std::index_sequence<I...>,
+  Args&&... args) -> decltype(auto) {
+  return std::invoke(
+    static_cast<Callable&&>(callable),
+    std::get<I>(static_cast<Tuple&&>(bound))...,
+    static_cast<Args&&>(args)...);
+}
+
+
+template <class Callable, class... Bound>
+class front_binder
+  : public composable<front_binder<Callable, Bound...>>
+  , private boost::empty_value<Callable, 0>
+{
+private:
+  using callable_holder = boost::empty_value<Callable, 0>;
+  using indices = std::index_sequence_for<Bound...>;
+
+public:
+  front_binder(Callable callable, Bound... bound)
+    : callable_holder(boost::empty_init_t(), std::move(callable))
+    , bound_(std::move(bound)...) {}
+
+  template <class... Args>
+  auto operator()(Args&&... args) & -> decltype(auto) {
+    return invoke_bound(
+      callable_holder::get(), bound_, indices(), static_cast<Args&&>(args)...);
+  }
+
+  template <class... Args>
+  auto operator()(Args&&... args) const& -> decltype(auto) {
+    return invoke_bound(
+      callable_holder::get(), bound_, indices(), static_cast<Args&&>(args)...);
+  }
+
+  template <class... Args>
+  auto operator()(Args&&... args) && -> decltype(auto) {
+    return invoke_bound(
+      std::move(callable_holder::get()),
+      std::move(bound_),
+      indices(),
+      static_cast<Args&&>(args)...);
+  }
+
+  template <class... Args>
+  auto operator()(Args&&... args) const&& -> decltype(auto) {
+    return invoke_bound(
+      std::move(callable_holder::get()),
+      std::move(bound_),
+      indices(),
+      static_cast<Args&&>(args)...);
+  }
+
+private:
+  std::tuple<Bound...> bound_;
+};
+
+
+} // namespace detail
+} // namespace xaos
+
+
+#endif // XAOS_DETAIL_COMPOSITION_HPP
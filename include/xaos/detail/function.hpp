@@ -2,101 +2,76 @@
 #define XAOS_DETAIL_FUNCTION_HPP
 
 
-#include <xaos/detail/backend_pointer.hpp>
-#include <xaos/detail/function_alloc.hpp>
+#include <xaos/detail/composition.hpp>
 #include <xaos/detail/function_overloads.hpp>
+#include <xaos/poly.hpp>
+#include <xaos/relocate.hpp>
 
-#include <boost/core/empty_value.hpp>
 #include <boost/mp11/algorithm.hpp>
+#include <boost/mp11/bind.hpp>
 #include <boost/mp11/list.hpp>
 #include <boost/mp11/utility.hpp>
 
+#include <memory>
+#include <type_traits>
+#include <utility>
+
 
 namespace xaos {
 namespace detail {
 
 
+template <class Traits>
+using call_overload_interface_for = boost::mp11::mp_if<
+  is_consume_on_call_enabled<Traits>,
+  boost::mp11::mp_quote<consuming_call_overload_interface>,
+  boost::mp11::mp_quote<call_overload_interface>>;
+
+template <class Traits>
+using call_overload_for = boost::mp11::mp_if<
+  is_consume_on_call_enabled<Traits>,
+  boost::mp11::mp_quote<consuming_call_overload>,
+  boost::mp11::mp_quote<call_overload>>;
+
+
+// The interface of the backends of functions. It is implemented by folding
+// the call overloads enabled by Traits, then their bulk slots, over the
+// backend.
 template <class Signature, class Traits>
-struct function_backend_interface
-  : alloc_interface
-  , boost::mp11::mp_apply<
+struct function_interface
+  : boost::mp11::mp_apply<
       boost::mp11::mp_inherit,
       boost::mp11::mp_append<
-        maybe_clone_interface<Traits>,
+        boost::mp11::mp_transform_q<
+          call_overload_interface_for<Traits>,
+          enabled_overloads<Signature, Traits>>,
         boost::mp11::mp_transform<
-          call_overload_interface,
-          enabled_overloads<Signature, Traits>>>> {
+          bulk_call_overload_interface,
+          bulk_overloads<Signature, Traits>>>> {
   using signature = Signature;
-  using traits = Traits;
-};
 
+  template <class Derived, class Base>
+  using implementation = boost::mp11::mp_fold_q<
+    bulk_overloads<Signature, Traits>,
+    boost::mp11::mp_fold_q<
+      enabled_overloads<Signature, Traits>,
+      Base,
+      boost::mp11::mp_bind_front_q<call_overload_for<Traits>, Derived>>,
+    boost::mp11::mp_bind_front<bulk_call_overload, Derived>>;
+
+protected:
+  ~function_interface() = default;
+};
 
-template <class BackendInterface, class Allocator, class Callable>
-struct function_backend final
-  : boost::mp11::mp_fold_q<
-      enabled_overloads<
-        typename BackendInterface::signature,
-        typename BackendInterface::traits>,
-      maybe_clone_implementation<
-        typename BackendInterface::traits,
-        function_backend<BackendInterface, Allocator, Callable>,
-        BackendInterface>,
-      boost::mp11::mp_bind_front<
-        call_overload,
-        function_backend<BackendInterface, Allocator, Callable>>>
-  , boost::empty_value<Callable, 0>
-  , pointer_storage_helper<
-      function_backend<BackendInterface, Allocator, Callable>,
-      Allocator,
-      1> {
-  using allocator_type = Allocator;
-  using callable_type = Callable;
-  using interface_type = BackendInterface;
-  using pointer_holder_t
-    = pointer_storage_helper<function_backend, Allocator, 1>;
-
-  function_backend(typename pointer_holder_t::pointer ptr, Callable callable)
-    : boost::empty_value<Callable, 0>(
-      boost::empty_init_t(), std::move(callable))
-    , pointer_holder_t(std::move(ptr)) {}
-
-  virtual auto relocate(void* type_erased_alloc) -> void* {
-    auto alloc
-      = restore_allocator<allocator_type, function_backend>(type_erased_alloc);
-    auto const raw_ptr = new_backend(alloc, std::move(callable()));
-    return static_cast<interface_type*>(raw_ptr);
-  };
-
-  virtual void delete_this(void* type_erased_alloc) {
-    auto alloc
-      = restore_allocator<allocator_type, function_backend>(type_erased_alloc);
-    auto const ptr = this->pointer_to(*this);
-
-    using proto_traits = std::allocator_traits<Allocator>;
-    using alloc_traits =
-      typename proto_traits::template rebind_traits<function_backend>;
-    alloc_traits::destroy(alloc, this);
-    alloc_traits::deallocate(alloc, ptr, 1);
-  };
-
-  auto callable() noexcept -> Callable& {
-    return boost::empty_value<Callable, 0>::get();
-  }
 
-  auto callable() const noexcept -> Callable const& {
-    return boost::empty_value<Callable, 0>::get();
+// Grants facilities built on top of basic_function access to its storage.
+struct function_access {
+  template <class Function>
+  static auto storage(Function& f) noexcept -> auto& {
+    return f.storage_;
   }
 };
 
-template <class Signature, class Traits, class Allocator>
-using backend_storage = boost::mp11::mp_apply_q<
-  boost::mp11::mp_if<
-    is_copyability_enabled<Traits>,
-    boost::mp11::mp_quote<copyable_backend_pointer>,
-    boost::mp11::mp_quote<backend_pointer>>,
-  boost::mp11::
-    mp_list<function_backend_interface<Signature, Traits>, Allocator>>;
-
 
 template <class Signature, class Traits, class Allocator, class... Overloads>
 class basic_function
@@ -104,43 +79,107 @@ class basic_function
       basic_function<Signature, Traits, Allocator, Overloads...>,
       are_rvalue_overloads_enabled<Traits>::value,
       Overloads>...
+  , public composable<
+      basic_function<Signature, Traits, Allocator, Overloads...>>
 {
 private:
   template <class, bool, class>
   friend struct parens_overload;
+  friend struct function_access;
 
-  using storage_t = backend_storage<Signature, Traits, Allocator>;
+  using storage_t
+    = poly<function_interface<Signature, Traits>, Traits, Allocator>;
   storage_t storage_;
 
+  static constexpr bool consumes_on_call
+    = is_consume_on_call_enabled<Traits>::value;
+
+  static constexpr bool bulk_call_enabled
+    = is_bulk_call_enabled<Traits>::value;
+
+  template <class R, class... Args>
+  static auto consume(storage_t& storage, Args... args) -> R {
+    // if moving the callable out throws, the backend is released on return
+    auto consumed = std::move(storage);
+    return consumed->call_r_consume(
+      &release_storage,
+      std::addressof(consumed),
+      static_cast<Args&&>(args)...);
+  }
+
+  static void release_storage(void* storage) noexcept {
+    auto const released = std::move(*static_cast<storage_t*>(storage));
+  }
+
 public:
   using allocator_type = typename storage_t::allocator_type;
 
   template <class Callable>
   basic_function(Callable callable, Allocator alloc = Allocator())
-    : storage_(alloc, callable) {}
+    : storage_(std::move(callable), alloc) {}
+
+  // Allocator-extended move and copy. They make functions stored in other
+  // functions use the allocator of the enclosing one.
+  basic_function(
+    std::allocator_arg_t, allocator_type const& alloc, basic_function&& other)
+    : storage_(std::allocator_arg, alloc, std::move(other.storage_)) {}
+
+  template <
+    class Storage = storage_t,
+    class = std::enable_if_t<std::is_copy_constructible<Storage>::value>>
+  basic_function(
+    std::allocator_arg_t,
+    allocator_type const& alloc,
+    basic_function const& other)
+    : storage_(std::allocator_arg, alloc, other.storage_) {}
 
   using parens_overload<
     basic_function<Signature, Traits, Allocator, Overloads...>,
     are_rvalue_overloads_enabled<Traits>::value,
     Overloads>::operator()...;
 
+  using parens_overload<
+    basic_function<Signature, Traits, Allocator, Overloads...>,
+    are_rvalue_overloads_enabled<Traits>::value,
+    Overloads>::invoke_bulk...;
+
+  // Whether the function holds a callable. Only moved from functions and
+  // functions consumed by a call are empty.
+  explicit operator bool() const noexcept {
+    return static_cast<bool>(storage_);
+  }
+
   auto get_allocator() const -> allocator_type {
     return storage_.get_allocator();
   }
 
-  void swap(basic_function& other) { storage_.swap(other.storage_); }
+  void swap(basic_function& other) noexcept(
+    noexcept(std::declval<storage_t&>().swap(std::declval<storage_t&>()))) {
+    storage_.swap(other.storage_);
+  }
 };
 
 
 template <class Signature, class Traits, class Allocator, class... Overloads>
 void swap(
   basic_function<Signature, Traits, Allocator, Overloads...>& l,
-  basic_function<Signature, Traits, Allocator, Overloads...>& r) {
+  basic_function<Signature, Traits, Allocator, Overloads...>& r) noexcept(
+  noexcept(l.swap(r))) {
   l.swap(r);
 }
 
 
 } // namespace detail
+
+
+template <class Signature, class Traits, class Allocator, class... Overloads>
+struct is_trivially_relocatable<
+  detail::basic_function<Signature, Traits, Allocator, Overloads...>>
+  : is_trivially_relocatable<
+      poly<detail::function_interface<Signature, Traits>, Traits, Allocator>> {
+};
+
+
 } // namespace xaos
 
 
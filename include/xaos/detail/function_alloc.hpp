@@ -6,8 +6,11 @@
 
 #include <boost/core/empty_value.hpp>
 #include <boost/mp11/function.hpp>
+#include <boost/mp11/integral.hpp>
 #include <boost/mp11/utility.hpp>
 
+#include <cstddef>
+
 
 namespace xaos {
 namespace detail {
@@ -21,6 +24,59 @@ using is_copyability_enabled = boost::mp11::
   mp_eval_or<boost::mp11::mp_false, copyability_enabled_helper, Traits>;
 
 
+template <class Traits>
+using deferred_destruction_enabled_helper
+  = boost::mp11::mp_bool<Traits::deferred_destruction>;
+
+template <class Traits>
+using is_deferred_destruction_enabled = boost::mp11::mp_eval_or<
+  boost::mp11::mp_false,
+  deferred_destruction_enabled_helper,
+  Traits>;
+
+
+template <class Traits>
+using thin_handle_enabled_helper = boost::mp11::mp_bool<Traits::thin_handle>;
+
+template <class Traits>
+using is_thin_handle_enabled = boost::mp11::
+  mp_eval_or<boost::mp11::mp_false, thin_handle_enabled_helper, Traits>;
+
+
+// Backends are aligned to, and padded to a multiple of, this many bytes, so
+// that backends of different functions do not share cache lines. Zero keeps
+// the natural alignment.
+template <class Traits>
+using backend_alignment_helper
+  = boost::mp11::mp_size_t<Traits::backend_alignment>;
+
+template <class Traits>
+using backend_alignment = boost::mp11::mp_eval_or<
+  boost::mp11::mp_size_t<0>,
+  backend_alignment_helper,
+  Traits>;
+
+template <std::size_t Alignment>
+struct alignas(Alignment) aligned_base {};
+
+template <>
+struct aligned_base<0> {};
+
+
+// Values whose backends fit into this many bytes are stored in the handle
+// itself. Zero disables the buffer.
+template <class Traits>
+using inline_capacity_helper = boost::mp11::mp_size_t<Traits::inline_capacity>;
+
+template <class Traits>
+using inline_capacity = boost::mp11::
+  mp_eval_or<boost::mp11::mp_size_t<0>, inline_capacity_helper, Traits>;
+
+template <class Traits>
+using is_inline_storage_enabled
+  = boost::mp11::mp_bool<inline_capacity<Traits>::value != 0>;
+
+
 template <class Traits>
 using maybe_clone_interface = boost::mp11::mp_if<
   is_copyability_enabled<Traits>,
@@ -37,6 +93,62 @@ using maybe_clone_implementation = boost::mp11::mp_eval_if_not<
   Base>;
 
 
+template <class Traits>
+using maybe_thin_interface = boost::mp11::mp_if<
+  is_thin_handle_enabled<Traits>,
+  boost::mp11::mp_list<thin_interface>,
+  boost::mp11::mp_list<>>;
+
+
+template <class Traits, class Derived, class Base>
+using maybe_thin_implementation = boost::mp11::mp_eval_if_not<
+  is_thin_handle_enabled<Traits>,
+  Base,
+  thin_implementation,
+  Derived,
+  Base>;
+
+
+template <class Traits>
+using maybe_inline_interface = boost::mp11::mp_cond<
+  boost::mp11::mp_not<is_inline_storage_enabled<Traits>>,
+  boost::mp11::mp_list<>,
+  is_copyability_enabled<Traits>,
+  boost::mp11::mp_list<inline_interface, inline_clone_interface>,
+  boost::mp11::mp_true,
+  boost::mp11::mp_list<inline_interface>>;
+
+
+template <class Traits, class Derived, class Base>
+using maybe_inline_implementation = boost::mp11::mp_eval_if_not<
+  is_inline_storage_enabled<Traits>,
+  Base,
+  inline_implementation,
+  Derived,
+  boost::mp11::mp_eval_if_not<
+    is_copyability_enabled<Traits>,
+    Base,
+    inline_clone_implementation,
+    Derived,
+    Base>>;
+
+
+template <class Allocator, unsigned Index, bool IsStored>
+struct allocator_storage : boost::empty_value<Allocator, Index> {
+  allocator_storage(Allocator const& alloc)
+    : boost::empty_value<Allocator, Index>(boost::empty_init_t(), alloc) {}
+
+  auto stored_allocator() const noexcept -> Allocator const& {
+    return boost::empty_value<Allocator, Index>::get();
+  }
+};
+
+template <class Allocator, unsigned Index>
+struct allocator_storage<Allocator, Index, false> {
+  allocator_storage(Allocator const&) noexcept {}
+};
+
+
 template <class Traits>
 using pointer_to_result = decltype(
   Traits::pointer::pointer_to(std::declval<typename Traits::element_type&>()));
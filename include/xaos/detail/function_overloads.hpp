@@ -2,11 +2,15 @@
 #define XAOS_DETAIL_FUNCTION_OVERLOADS_HPP
 
 
+#include <xaos/span.hpp>
+
+#include <boost/assert.hpp>
 #include <boost/mp11/algorithm.hpp>
 #include <boost/mp11/bind.hpp>
 #include <boost/type_traits/copy_cv_ref.hpp>
 
 #include <functional>
+#include <utility>
 
 
 namespace xaos {
@@ -16,24 +20,24 @@ namespace detail {
 template <class Signature, class RefKind>
 struct signature_overload_impl;
 
-template <class R, class... Args, class T>
-struct signature_overload_impl<R(Args...), T&> {
-  using type = R(Args...) &;
+template <class R, class... Args, bool NoExcept, class T>
+struct signature_overload_impl<R(Args...) noexcept(NoExcept), T&> {
+  using type = R(Args...) & noexcept(NoExcept);
 };
 
-template <class R, class... Args, class T>
-struct signature_overload_impl<R(Args...), T const&> {
-  using type = R(Args...) const&;
+template <class R, class... Args, bool NoExcept, class T>
+struct signature_overload_impl<R(Args...) noexcept(NoExcept), T const&> {
+  using type = R(Args...) const& noexcept(NoExcept);
 };
 
-template <class R, class... Args, class T>
-struct signature_overload_impl<R(Args...), T&&> {
-  using type = R(Args...) &&;
+template <class R, class... Args, bool NoExcept, class T>
+struct signature_overload_impl<R(Args...) noexcept(NoExcept), T&&> {
+  using type = R(Args...) && noexcept(NoExcept);
 };
 
-template <class R, class... Args, class T>
-struct signature_overload_impl<R(Args...), T const&&> {
-  using type = R(Args...) const&&;
+template <class R, class... Args, bool NoExcept, class T>
+struct signature_overload_impl<R(Args...) noexcept(NoExcept), T const&&> {
+  using type = R(Args...) const&& noexcept(NoExcept);
 };
 
 template <class Signature, class RefKind>
@@ -97,88 +101,306 @@ using are_rvalue_overloads_enabled = boost::mp11::mp_or<
   trait_for_ref_kind<Traits, int const&&>>;
 
 
+template <class Traits>
+using consume_on_call_enabled_helper
+  = boost::mp11::mp_bool<Traits::consume_on_call>;
+
+// The rvalue call releases the backend before returning and leaves the
+// function empty.
+template <class Traits>
+using is_consume_on_call_enabled = boost::mp11::mp_eval_or<
+  boost::mp11::mp_false,
+  consume_on_call_enabled_helper,
+  Traits>;
+
+
+// Arguments of bulk invocations are passed as arrays. Reference parameters
+// refer to array elements, other parameters are copied from them.
+template <class Arg>
+using bulk_argument = std::conditional_t<
+  std::is_reference<Arg>::value,
+  std::remove_reference_t<Arg>,
+  Arg const>;
+
+template <class R>
+using bulk_result = std::conditional_t<
+  std::is_reference<R>::value,
+  std::reference_wrapper<std::remove_reference_t<R>>,
+  R>;
+
+template <class R>
+using bulk_result_pointer
+  = std::conditional_t<std::is_void<R>::value, void*, bulk_result<R>*>;
+
+template <class R>
+using is_bulk_invocable = boost::mp11::mp_or<
+  std::is_void<R>,
+  std::is_move_assignable<bulk_result<R>>>;
+
+
+template <class Traits>
+using bulk_call_enabled_helper = boost::mp11::mp_bool<Traits::bulk_call>;
+
+// Lvalue call overloads get a bulk slot in the backend interface, used by
+// invoke_bulk. It is opt-in, as every slot enlarges the vtables of all
+// callables stored.
+template <class Traits>
+using is_bulk_call_enabled = boost::mp11::
+  mp_eval_or<boost::mp11::mp_false, bulk_call_enabled_helper, Traits>;
+
+template <class Signature, class Traits>
+using bulk_overloads = boost::mp11::mp_if<
+  is_bulk_call_enabled<Traits>,
+  enabled_overloads<Signature, Traits>,
+  boost::mp11::mp_list<>>;
+
+// invoke_bulk is only declared by functions with bulk slots, and only for
+// results that can be stored in arrays.
+template <bool BulkCallEnabled, class R>
+using enable_bulk_call
+  = std::enable_if_t<BulkCallEnabled && is_bulk_invocable<R>::value>;
+
+
 template <class Overload>
 struct call_overload_interface;
 
-template <class R, class... Args>
-struct call_overload_interface<R(Args...)&> {
-  virtual auto call_l(Args... args) -> R = 0;
+template <class R, class... Args, bool NoExcept>
+struct call_overload_interface<R(Args...) & noexcept(NoExcept)> {
+  virtual auto call_l(Args... args) noexcept(NoExcept) -> R = 0;
 
 protected:
   ~call_overload_interface() = default;
 };
 
-template <class R, class... Args>
-struct call_overload_interface<R(Args...) const&> {
-  virtual auto call_cl(Args... args) const -> R = 0;
+template <class R, class... Args, bool NoExcept>
+struct call_overload_interface<R(Args...) const& noexcept(NoExcept)> {
+  virtual auto call_cl(Args... args) const noexcept(NoExcept) -> R = 0;
 
 protected:
   ~call_overload_interface() = default;
 };
 
-template <class R, class... Args>
-struct call_overload_interface<R(Args...) &&> {
-  virtual auto call_r(Args... args) -> R = 0;
+template <class R, class... Args, bool NoExcept>
+struct call_overload_interface<R(Args...) && noexcept(NoExcept)> {
+  virtual auto call_r(Args... args) noexcept(NoExcept) -> R = 0;
 
 protected:
   ~call_overload_interface() = default;
 };
 
-template <class R, class... Args>
-struct call_overload_interface<R(Args...) const&&> {
-  virtual auto call_cr(Args... args) const -> R = 0;
+template <class R, class... Args, bool NoExcept>
+struct call_overload_interface<R(Args...) const&& noexcept(NoExcept)> {
+  virtual auto call_cr(Args... args) const noexcept(NoExcept) -> R = 0;
 
 protected:
   ~call_overload_interface() = default;
 };
 
 
-template <class R, class T, class... Args>
-auto forward_to_callable(T&& t, Args... args) -> R {
-  using callable_type = typename std::remove_reference_t<T>::callable_type;
-  using callable_ref = boost::copy_cv_ref_t<callable_type, T&&>;
-  return std::invoke(static_cast<callable_ref>(t.callable()), args...);
+// Arguments are forwarded as the signature declares them. Callables which
+// cannot take them so, like non-const member functions called through const
+// references, are passed copies instead. The copies are made by the caller,
+// as parameters.
+template <bool Forward, class Arg>
+using passed_argument = std::conditional_t<Forward, Arg&&, std::decay_t<Arg>>;
+
+template <bool Forward, class Callable, class... Args>
+using is_nothrow_passable = std::is_nothrow_invocable<
+  Callable,
+  std::conditional_t<Forward, Args&&, std::decay_t<Args>&>...>;
+
+template <class T>
+using stored_callable_ref = boost::copy_cv_ref_t<
+  typename std::remove_reference_t<T>::value_type,
+  T&&>;
+
+template <
+  class R,
+  bool NoExcept,
+  class... Args,
+  class Callable,
+  bool Forward = std::is_invocable<Callable, Args...>::value>
+auto invoke_callable(
+  Callable&& callable,
+  passed_argument<Forward, Args>... args) noexcept(NoExcept) -> R {
+  static_assert(
+    !NoExcept || is_nothrow_passable<Forward, Callable, Args...>::value,
+    "callables stored for noexcept signatures must not throw");
+  if constexpr (Forward) {
+    return std::invoke(
+      static_cast<Callable&&>(callable), static_cast<Args&&>(args)...);
+  } else {
+    return std::invoke(static_cast<Callable&&>(callable), args...);
+  }
+}
+
+// Same as invoke_callable, for the callable stored in a backend. It invokes
+// the callable itself, so that the copies stay in the frame of the caller.
+template <
+  class R,
+  bool NoExcept,
+  class... Args,
+  class T,
+  bool Forward = std::is_invocable<stored_callable_ref<T>, Args...>::value>
+auto forward_to_callable(
+  T&& t, passed_argument<Forward, Args>... args) noexcept(NoExcept) -> R {
+  using callable_ref = stored_callable_ref<T>;
+  static_assert(
+    !NoExcept || is_nothrow_passable<Forward, callable_ref, Args...>::value,
+    "callables stored for noexcept signatures must not throw");
+  if constexpr (Forward) {
+    return std::invoke(
+      static_cast<callable_ref>(t.value()), static_cast<Args&&>(args)...);
+  } else {
+    return std::invoke(static_cast<callable_ref>(t.value()), args...);
+  }
+}
+
+
+// The loop runs inside the backend, where the concrete type of the callable
+// is known, so the call can be inlined and the loop vectorized.
+template <class R, bool NoExcept, class... Args, class T, class... In>
+void bulk_forward_to_callable(
+  T&& t, std::size_t n, bulk_result_pointer<R> out, In*... in) noexcept(
+  NoExcept) {
+  static_assert(is_bulk_invocable<R>::value);
+  using callable_type = typename std::remove_reference_t<T>::value_type;
+  using callable_ref = boost::copy_cv_ref_t<callable_type, T&>;
+  auto& callable = static_cast<callable_ref>(t.value());
+  for (std::size_t i = 0; i != n; ++i) {
+    if constexpr (std::is_void<R>::value) {
+      invoke_callable<R, NoExcept, Args...>(
+        callable, static_cast<Args>(in[i])...);
+    } else {
+      out[i] = invoke_callable<R, NoExcept, Args...>(
+        callable, static_cast<Args>(in[i])...);
+    }
+  }
 }
 
 
+// The bulk slots of the lvalue call overloads. Overloads without a bulk slot,
+// and those whose results cannot be stored in arrays, add nothing.
+template <class Overload, class = void>
+struct bulk_call_overload_interface {
+protected:
+  ~bulk_call_overload_interface() = default;
+};
+
+template <class R, class... Args, bool NoExcept>
+struct bulk_call_overload_interface<
+  R(Args...) & noexcept(NoExcept),
+  std::enable_if_t<is_bulk_invocable<R>::value>> {
+  virtual void call_l_bulk(
+    std::size_t n,
+    bulk_result_pointer<R> out,
+    bulk_argument<Args>*... in) noexcept(NoExcept)
+    = 0;
+
+protected:
+  ~bulk_call_overload_interface() = default;
+};
+
+template <class R, class... Args, bool NoExcept>
+struct bulk_call_overload_interface<
+  R(Args...) const& noexcept(NoExcept),
+  std::enable_if_t<is_bulk_invocable<R>::value>> {
+  virtual void call_cl_bulk(
+    std::size_t n,
+    bulk_result_pointer<R> out,
+    bulk_argument<Args>*... in) const noexcept(NoExcept) = 0;
+
+protected:
+  ~bulk_call_overload_interface() = default;
+};
+
+
+template <class Derived, class Base, class Overload, class = void>
+struct bulk_call_overload : Base {
+protected:
+  ~bulk_call_overload() = default;
+};
+
+template <class Derived, class Base, class R, class... Args, bool NoExcept>
+struct bulk_call_overload<
+  Derived,
+  Base,
+  R(Args...) & noexcept(NoExcept),
+  std::enable_if_t<is_bulk_invocable<R>::value>> : Base {
+  void call_l_bulk(
+    std::size_t n,
+    bulk_result_pointer<R> out,
+    bulk_argument<Args>*... in) noexcept(NoExcept) override {
+    bulk_forward_to_callable<R, NoExcept, Args...>(
+      static_cast<Derived&>(*this), n, out, in...);
+  }
+
+protected:
+  ~bulk_call_overload() = default;
+};
+
+template <class Derived, class Base, class R, class... Args, bool NoExcept>
+struct bulk_call_overload<
+  Derived,
+  Base,
+  R(Args...) const& noexcept(NoExcept),
+  std::enable_if_t<is_bulk_invocable<R>::value>> : Base {
+  void call_cl_bulk(
+    std::size_t n,
+    bulk_result_pointer<R> out,
+    bulk_argument<Args>*... in) const noexcept(NoExcept) override {
+    bulk_forward_to_callable<R, NoExcept, Args...>(
+      static_cast<Derived const&>(*this), n, out, in...);
+  }
+
+protected:
+  ~bulk_call_overload() = default;
+};
+
+
 template <class Derived, class Base, class Signature>
 struct call_overload;
 
-template <class Derived, class Base, class R, class... Args>
-struct call_overload<Derived, Base, R(Args...)&> : Base {
-  auto call_l(Args... args) -> R override {
-    return forward_to_callable<R>(static_cast<Derived&>(*this), args...);
+template <class Derived, class Base, class R, class... Args, bool NoExcept>
+struct call_overload<Derived, Base, R(Args...) & noexcept(NoExcept)> : Base {
+  auto call_l(Args... args) noexcept(NoExcept) -> R override {
+    return forward_to_callable<R, NoExcept, Args...>(
+      static_cast<Derived&>(*this), static_cast<Args&&>(args)...);
   }
 
 protected:
   ~call_overload() = default;
 };
 
-template <class Derived, class Base, class R, class... Args>
-struct call_overload<Derived, Base, R(Args...) const&> : Base {
-  auto call_cl(Args... args) const -> R override {
-    return forward_to_callable<R>(static_cast<Derived const&>(*this), args...);
+template <class Derived, class Base, class R, class... Args, bool NoExcept>
+struct call_overload<Derived, Base, R(Args...) const& noexcept(NoExcept)>
+  : Base {
+  auto call_cl(Args... args) const noexcept(NoExcept) -> R override {
+    return forward_to_callable<R, NoExcept, Args...>(
+      static_cast<Derived const&>(*this), static_cast<Args&&>(args)...);
   }
 
 protected:
   ~call_overload() = default;
 };
 
-template <class Derived, class Base, class R, class... Args>
-struct call_overload<Derived, Base, R(Args...) &&> : Base {
-  auto call_r(Args... args) -> R override {
-    return forward_to_callable<R>(static_cast<Derived&&>(*this), args...);
+template <class Derived, class Base, class R, class... Args, bool NoExcept>
+struct call_overload<Derived, Base, R(Args...) && noexcept(NoExcept)> : Base {
+  auto call_r(Args... args) noexcept(NoExcept) -> R override {
+    return forward_to_callable<R, NoExcept, Args...>(
+      static_cast<Derived&&>(*this), static_cast<Args&&>(args)...);
   }
 
 protected:
   ~call_overload() = default;
 };
 
-template <class Derived, class Base, class R, class... Args>
-struct call_overload<Derived, Base, R(Args...) const&&> : Base {
-  auto call_cr(Args... args) const -> R override {
-    return forward_to_callable<R>(
-      static_cast<Derived const&&>(*this), args...);
+template <class Derived, class Base, class R, class... Args, bool NoExcept>
+struct call_overload<Derived, Base, R(Args...) const&& noexcept(NoExcept)>
+  : Base {
+  auto call_cr(Args... args) const noexcept(NoExcept) -> R override {
+    return forward_to_callable<R, NoExcept, Args...>(
+      static_cast<Derived const&&>(*this), static_cast<Args&&>(args)...);
   }
 
 protected:
@@ -186,71 +408,227 @@ protected:
 };
 
 
+// In consume-on-call mode the rvalue call moves the callable out of the
+// backend and releases the backend, through release(owner), before invoking
+// the callable. Memory allocated for the backend can then be reused by
+// whatever the callable does, as Asio requires of completion handlers.
+// Other overloads are the same as without consuming.
+using consume_release = void (*)(void* owner) noexcept;
+
+template <class Signature>
+struct consuming_call_overload_interface : call_overload_interface<Signature> {
+protected:
+  ~consuming_call_overload_interface() = default;
+};
+
+template <class R, class... Args, bool NoExcept>
+struct consuming_call_overload_interface<R(Args...) && noexcept(NoExcept)> {
+  virtual auto call_r_consume(
+    consume_release release, void* owner, Args... args) noexcept(NoExcept)
+    -> R = 0;
+
+protected:
+  ~consuming_call_overload_interface() = default;
+};
+
+template <class Derived, class Base, class Signature>
+struct consuming_call_overload : call_overload<Derived, Base, Signature> {
+protected:
+  ~consuming_call_overload() = default;
+};
+
+template <class Derived, class Base, class R, class... Args, bool NoExcept>
+struct consuming_call_overload<Derived, Base, R(Args...) && noexcept(NoExcept)>
+  : Base {
+  auto call_r_consume(
+    consume_release release, void* owner, Args... args) noexcept(NoExcept)
+    -> R override {
+    using callable_type = typename Derived::value_type;
+    static_assert(
+      !NoExcept || std::is_nothrow_invocable<callable_type&&, Args...>::value,
+      "callables stored for noexcept signatures must not throw");
+    auto callable
+      = callable_type(std::move(static_cast<Derived&>(*this).value()));
+    // destroys *this
+    release(owner);
+    return std::invoke(std::move(callable), static_cast<Args&&>(args)...);
+  }
+
+protected:
+  ~consuming_call_overload() = default;
+};
+
+
+struct no_bulk_output {};
+
+template <class R>
+using bulk_output = std::conditional_t<
+  std::is_void<R>::value,
+  no_bulk_output,
+  span<bulk_result<R>>>;
+
+inline auto bulk_output_data(no_bulk_output) noexcept -> void* {
+  return nullptr;
+}
+
+template <class T>
+auto bulk_output_data(span<T> out) noexcept -> T* {
+  return out.data();
+}
+
+template <class... In>
+auto bulk_call_size(no_bulk_output, span<In>... in) -> std::size_t {
+  auto n = std::size_t(0);
+  static_cast<void>(((n = in.size()), ...));
+  BOOST_ASSERT(((in.size() == n) && ...));
+  return n;
+}
+
+template <class T, class... In>
+auto bulk_call_size(span<T> out, span<In>... in) -> std::size_t {
+  ((void)in, ...);
+  BOOST_ASSERT(((in.size() == out.size()) && ...));
+  return out.size();
+}
+
+
 template <class Derived, bool HasRvalueOverloads, class Overload>
 struct parens_overload;
 
-template <class Derived, class R, class... Args>
-struct parens_overload<Derived, true, R(Args...)&> {
-  auto operator()(Args... args) & -> R {
+template <class Derived, class R, class... Args, bool NoExcept>
+struct parens_overload<Derived, true, R(Args...) & noexcept(NoExcept)> {
+  auto operator()(Args... args) & noexcept(NoExcept) -> R {
     auto& self = static_cast<Derived&>(*this);
-    return self.storage_->call_l(args...);
+    return self.storage_->call_l(static_cast<Args&&>(args)...);
+  }
+
+  template <
+    class D = Derived,
+    class = enable_bulk_call<D::bulk_call_enabled, R>>
+  void invoke_bulk(
+    span<bulk_argument<Args>>... in,
+    bulk_output<R> out = {}) & noexcept(NoExcept) {
+    auto& self = static_cast<Derived&>(*this);
+    self.storage_->call_l_bulk(
+      bulk_call_size(out, in...), bulk_output_data(out), in.data()...);
   }
 
 protected:
   ~parens_overload() = default;
 };
 
-template <class Derived, class R, class... Args>
-struct parens_overload<Derived, false, R(Args...)&> {
-  auto operator()(Args... args) -> R {
+template <class Derived, class R, class... Args, bool NoExcept>
+struct parens_overload<Derived, false, R(Args...) & noexcept(NoExcept)> {
+  auto operator()(Args... args) noexcept(NoExcept) -> R {
+    auto& self = static_cast<Derived&>(*this);
+    return self.storage_->call_l(static_cast<Args&&>(args)...);
+  }
+
+  template <
+    class D = Derived,
+    class = enable_bulk_call<D::bulk_call_enabled, R>>
+  void invoke_bulk(
+    span<bulk_argument<Args>>... in,
+    bulk_output<R> out = {}) noexcept(NoExcept) {
     auto& self = static_cast<Derived&>(*this);
-    return self.storage_->call_l(args...);
+    self.storage_->call_l_bulk(
+      bulk_call_size(out, in...), bulk_output_data(out), in.data()...);
   }
 
 protected:
   ~parens_overload() = default;
 };
 
-template <class Derived, class R, class... Args>
-struct parens_overload<Derived, true, R(Args...) const&> {
-  auto operator()(Args... args) const& -> R {
+template <class Derived, class R, class... Args, bool NoExcept>
+struct parens_overload<Derived, true, R(Args...) const& noexcept(NoExcept)> {
+  auto operator()(Args... args) const& noexcept(NoExcept) -> R {
+    auto& self = static_cast<Derived const&>(*this);
+    return self.storage_->call_cl(static_cast<Args&&>(args)...);
+  }
+
+  template <
+    class D = Derived,
+    class = enable_bulk_call<D::bulk_call_enabled, R>>
+  void invoke_bulk(
+    span<bulk_argument<Args>>... in,
+    bulk_output<R> out = {}) const& noexcept(NoExcept) {
     auto& self = static_cast<Derived const&>(*this);
-    return self.storage_->call_cl(args...);
+    self.storage_->call_cl_bulk(
+      bulk_call_size(out, in...), bulk_output_data(out), in.data()...);
   }
 
 protected:
   ~parens_overload() = default;
 };
 
-template <class Derived, class R, class... Args>
-struct parens_overload<Derived, false, R(Args...) const&> {
-  auto operator()(Args... args) const -> R {
+template <class Derived, class R, class... Args, bool NoExcept>
+struct parens_overload<Derived, false, R(Args...) const& noexcept(NoExcept)> {
+  auto operator()(Args... args) const noexcept(NoExcept) -> R {
+    auto& self = static_cast<Derived const&>(*this);
+    return self.storage_->call_cl(static_cast<Args&&>(args)...);
+  }
+
+  template <
+    class D = Derived,
+    class = enable_bulk_call<D::bulk_call_enabled, R>>
+  void invoke_bulk(
+    span<bulk_argument<Args>>... in,
+    bulk_output<R> out = {}) const noexcept(NoExcept) {
     auto& self = static_cast<Derived const&>(*this);
-    return self.storage_->call_cl(args...);
+    self.storage_->call_cl_bulk(
+      bulk_call_size(out, in...), bulk_output_data(out), in.data()...);
   }
 
 protected:
   ~parens_overload() = default;
 };
 
-template <class Derived, bool HasRvalueOverloads, class R, class... Args>
-struct parens_overload<Derived, HasRvalueOverloads, R(Args...) &&> {
-  auto operator()(Args... args) && -> R {
+template <
+  class Derived,
+  bool HasRvalueOverloads,
+  class R,
+  class... Args,
+  bool NoExcept>
+struct parens_overload<
+  Derived,
+  HasRvalueOverloads,
+  R(Args...) && noexcept(NoExcept)> {
+  auto operator()(Args... args) && noexcept(NoExcept) -> R {
     auto& self = static_cast<Derived&>(*this);
-    return self.storage_->call_r(args...);
+    if constexpr (Derived::consumes_on_call) {
+      return Derived::template consume<R, Args...>(
+        self.storage_, static_cast<Args&&>(args)...);
+    } else {
+      return self.storage_->call_r(static_cast<Args&&>(args)...);
+    }
   }
 
+  // bulk invocation would consume the callable on the first call
+  template <class... Ts>
+  void invoke_bulk(Ts&&...) && = delete;
+
 protected:
   ~parens_overload() = default;
 };
 
-template <class Derived, bool HasRvalueOverloads, class R, class... Args>
-struct parens_overload<Derived, HasRvalueOverloads, R(Args...) const&&> {
-  auto operator()(Args... args) const&& -> R {
+template <
+  class Derived,
+  bool HasRvalueOverloads,
+  class R,
+  class... Args,
+  bool NoExcept>
+struct parens_overload<
+  Derived,
+  HasRvalueOverloads,
+  R(Args...) const&& noexcept(NoExcept)> {
+  auto operator()(Args... args) const&& noexcept(NoExcept) -> R {
     auto& self = static_cast<Derived const&>(*this);
-    return self.storage_->call_cr(args...);
+    return self.storage_->call_cr(static_cast<Args&&>(args)...);
   }
 
+  template <class... Ts>
+  void invoke_bulk(Ts&&...) const&& = delete;
+
 protected:
   ~parens_overload() = default;
 };
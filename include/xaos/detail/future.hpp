@@ -0,0 +1,256 @@
+#ifndef XAOS_DETAIL_FUTURE_HPP
+#define XAOS_DETAIL_FUTURE_HPP
+
+
+#include <xaos/detail/backend_alloc.hpp>
+#include <xaos/detail/cache_line.hpp>
+#include <xaos/detail/function_alloc.hpp>
+
+#include <boost/core/empty_value.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+
+namespace xaos {
+namespace detail {
+
+
+struct void_result {};
+
+template <class T>
+using stored_result
+  = std::conditional_t<std::is_void<T>::value, void_result, T>;
+
+
+// Threads blocked on futures park on one of a fixed set of condition
+// variables, picked by the address of the state, so that states do not grow
+// by a mutex and a condition variable each.
+struct alignas(cache_line_size) parking_slot {
+  std::mutex mutex;
+  std::condition_variable cv;
+};
+
+inline auto parking_slot_for(void const* address) noexcept -> parking_slot& {
+  static parking_slot slots[64];
+  auto const hash = reinterpret_cast<std::uintptr_t>(address) / 64;
+  return slots[hash % (sizeof(slots) / sizeof(slots[0]))];
+}
+
+
+template <class T>
+struct future_state;
+
+template <class T>
+struct continuation {
+  // Called once the result of the state is set. Takes over the reference to
+  // the state held by the future which the continuation was attached to.
+  virtual void run(future_state<T>& from) noexcept = 0;
+
+protected:
+  ~continuation() = default;
+};
+
+
+// The state shared by a promise (or a continuation producing the result) and
+// a future. Whichever of setting the result and attaching a continuation
+// happens last runs the continuation inline.
+template <class T>
+struct future_state {
+  static constexpr unsigned has_result = 1;
+  static constexpr unsigned has_continuation = 2;
+  static constexpr unsigned has_waiter = 4;
+
+  explicit future_state(unsigned refs) noexcept : refs(refs) {}
+
+  virtual void destroy() noexcept = 0;
+
+  template <class... Args>
+  void set_value(Args&&... args) {
+    result.template emplace<1>(static_cast<Args&&>(args)...);
+    publish();
+  }
+
+  void set_exception(std::exception_ptr e) noexcept {
+    result.template emplace<2>(std::move(e));
+    publish();
+  }
+
+  void attach(continuation<T>& c) noexcept {
+    next = &c;
+    auto const flags
+      = state.fetch_or(has_continuation, std::memory_order_acq_rel);
+    if (flags & has_result) { c.run(*this); }
+  }
+
+  auto is_ready() const noexcept -> bool {
+    return state.load(std::memory_order_acquire) & has_result;
+  }
+
+  // Spins briefly, as results are often set right away, then blocks.
+  void wait() noexcept {
+    for (int i = 0; i != 128; ++i) {
+      if (is_ready()) { return; }
+    }
+    auto& slot = parking_slot_for(this);
+    auto lock = std::unique_lock<std::mutex>(slot.mutex);
+    auto const flags = state.fetch_or(has_waiter, std::memory_order_acq_rel);
+    if (flags & has_result) { return; }
+    slot.cv.wait(lock, [this] { return is_ready(); });
+  }
+
+  // Moves the result out of the state, or throws the stored exception.
+  auto take() -> T {
+    if (result.index() == 2) { std::rethrow_exception(std::get<2>(result)); }
+    if constexpr (!std::is_void<T>::value) {
+      return std::move(std::get<1>(result));
+    }
+  }
+
+  void add_ref() noexcept { refs.fetch_add(1, std::memory_order_relaxed); }
+
+  void release() noexcept {
+    if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) { destroy(); }
+  }
+
+  std::variant<std::monostate, stored_result<T>, std::exception_ptr> result;
+  continuation<T>* next = nullptr;
+  std::atomic<unsigned> state{0};
+  std::atomic<unsigned> refs;
+
+protected:
+  ~future_state() = default;
+
+private:
+  // A waiter sets its flag while holding the mutex of its slot, so taking
+  // the mutex after setting the result orders the notification after the
+  // waiter has started waiting.
+  void publish() noexcept {
+    auto& slot = parking_slot_for(this);
+    auto const flags = state.fetch_or(has_result, std::memory_order_acq_rel);
+    if (flags & has_waiter) {
+      { auto const lock = std::lock_guard<std::mutex>(slot.mutex); }
+      slot.cv.notify_all();
+    }
+    if (flags & has_continuation) { next->run(*this); }
+  }
+};
+
+
+template <class Node, class Allocator>
+void destroy_node(Node& node, Allocator const& proto_alloc) noexcept {
+  using alloc_traits = typename std::allocator_traits<
+    Allocator>::template rebind_traits<Node>;
+  auto alloc = typename alloc_traits::allocator_type(proto_alloc);
+  auto const ptr = node.pointer_to(node);
+  alloc_traits::destroy(alloc, std::addressof(node));
+  alloc_traits::deallocate(alloc, ptr, 1);
+}
+
+
+template <class T, class Allocator>
+struct promise_state final
+  : future_state<T>
+  , boost::empty_value<Allocator, 0>
+  , pointer_storage_helper<promise_state<T, Allocator>, Allocator, 1> {
+  using pointer_holder_t
+    = pointer_storage_helper<promise_state, Allocator, 1>;
+
+  promise_state(typename pointer_holder_t::pointer ptr, Allocator const& alloc)
+    : future_state<T>(1)
+    , boost::empty_value<Allocator, 0>(boost::empty_init_t(), alloc)
+    , pointer_holder_t(std::move(ptr)) {}
+
+  void destroy() noexcept override {
+    auto const alloc = boost::empty_value<Allocator, 0>::get();
+    destroy_node(*this, alloc);
+  }
+};
+
+
+template <class F, class T>
+struct continuation_result_impl {
+  using type = std::invoke_result_t<F&&, T&&>;
+};
+
+template <class F>
+struct continuation_result_impl<F, void> {
+  using type = std::invoke_result_t<F&&>;
+};
+
+template <class F, class T>
+using continuation_result = typename continuation_result_impl<F, T>::type;
+
+
+// The state of the future returned by then. The continuation waiting for the
+// previous result and the state receiving its own result are the same object,
+// so a continuation costs exactly one allocation.
+template <class T, class F, class Allocator>
+struct continuation_state final
+  : future_state<continuation_result<F, T>>
+  , continuation<T>
+  , boost::empty_value<F, 0>
+  , boost::empty_value<Allocator, 1>
+  , pointer_storage_helper<continuation_state<T, F, Allocator>, Allocator, 2> {
+  using result_type = continuation_result<F, T>;
+  using pointer_holder_t
+    = pointer_storage_helper<continuation_state, Allocator, 2>;
+
+  // one reference for the future, one released after the continuation ran
+  continuation_state(
+    typename pointer_holder_t::pointer ptr, F f, Allocator const& alloc)
+    : future_state<result_type>(2)
+    , boost::empty_value<F, 0>(boost::empty_init_t(), std::move(f))
+    , boost::empty_value<Allocator, 1>(boost::empty_init_t(), alloc)
+    , pointer_holder_t(std::move(ptr)) {}
+
+  void run(future_state<T>& from) noexcept override {
+    auto& f = boost::empty_value<F, 0>::get();
+    if (from.result.index() == 2) {
+      this->set_exception(std::get<2>(from.result));
+    } else {
+      try {
+        if constexpr (std::is_void<result_type>::value) {
+          invoke(std::move(f), from);
+          this->set_value();
+        } else {
+          this->set_value(invoke(std::move(f), from));
+        }
+      } catch (...) {
+        this->set_exception(std::current_exception());
+      }
+    }
+    from.release();
+    this->release();
+  }
+
+  void destroy() noexcept override {
+    auto const alloc = boost::empty_value<Allocator, 1>::get();
+    destroy_node(*this, alloc);
+  }
+
+private:
+  static auto invoke(F&& f, future_state<T>& from) -> result_type {
+    if constexpr (std::is_void<T>::value) {
+      return std::invoke(std::move(f));
+    } else {
+      return std::invoke(std::move(f), std::move(std::get<1>(from.result)));
+    }
+  }
+};
+
+
+} // namespace detail
+} // namespace xaos
+
+
+#endif // XAOS_DETAIL_FUTURE_HPP
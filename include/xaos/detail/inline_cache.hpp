@@ -0,0 +1,95 @@
+#ifndef XAOS_DETAIL_INLINE_CACHE_HPP
+#define XAOS_DETAIL_INLINE_CACHE_HPP
+
+
+#include <xaos/detail/function.hpp>
+
+#include <boost/mp11/list.hpp>
+#include <boost/type_traits/copy_cv.hpp>
+
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+
+namespace xaos {
+namespace detail {
+
+
+template <class Function, class... Args>
+using guarded_call_result
+  = decltype(std::declval<Function&>()(std::declval<Args>()...));
+
+template <class Function>
+using function_storage_t = std::remove_reference_t<
+  decltype(function_access::storage(std::declval<Function&>()))>;
+
+// The backend type which a function stores Callable in, as const as the
+// function.
+template <class Function, class Callable>
+using backend_for = boost::copy_cv_t<
+  poly_backend<
+    poly_backend_interface<
+      typename function_storage_t<Function>::interface_type,
+      typename function_storage_t<Function>::traits_type>,
+    typename function_storage_t<Function>::allocator_type,
+    std::decay_t<Callable>>,
+  std::remove_reference_t<Function>>;
+
+
+// Calls the same overload as the parentheses operator of the function would.
+// The backend type is final, so the call is not virtual.
+template <class Backend, class... Args>
+auto call_backend(Backend& backend, Args&&... args) -> decltype(auto) {
+  using traits = typename Backend::interface_type::traits;
+  if constexpr (
+    !std::is_const<Backend>::value
+    && trait_for_ref_kind<traits, int&>::value) {
+    return backend.call_l(static_cast<Args&&>(args)...);
+  } else {
+    return backend.call_cl(static_cast<Args&&>(args)...);
+  }
+}
+
+
+template <class Function, class... Args>
+auto guarded_call(
+  Function& f,
+  std::type_info const&,
+  bool& hit,
+  boost::mp11::mp_list<>,
+  Args&&... args) -> guarded_call_result<Function, Args&&...> {
+  hit = false;
+  return f(static_cast<Args&&>(args)...);
+}
+
+// Type infos are compared by address. Equal types may have distinct type
+// infos when shared libraries are involved, which only leads to a miss.
+template <class Function, class Callable, class... Callables, class... Args>
+auto guarded_call(
+  Function& f,
+  std::type_info const& type,
+  bool& hit,
+  boost::mp11::mp_list<Callable, Callables...>,
+  Args&&... args) -> guarded_call_result<Function, Args&&...> {
+  using backend_type = backend_for<Function, Callable>;
+  if (&type == &typeid(backend_type)) {
+    hit = true;
+    auto& backend = *function_access::storage(f);
+    return call_backend(
+      static_cast<backend_type&>(backend), static_cast<Args&&>(args)...);
+  }
+  return guarded_call(
+    f,
+    type,
+    hit,
+    boost::mp11::mp_list<Callables...>(),
+    static_cast<Args&&>(args)...);
+}
+
+
+} // namespace detail
+} // namespace xaos
+
+
+#endif // XAOS_DETAIL_INLINE_CACHE_HPP
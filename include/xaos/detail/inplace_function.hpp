@@ -0,0 +1,513 @@
+#ifndef XAOS_DETAIL_INPLACE_FUNCTION_HPP
+#define XAOS_DETAIL_INPLACE_FUNCTION_HPP
+
+
+#include <xaos/detail/function_alloc.hpp>
+#include <xaos/detail/function_overloads.hpp>
+#include <xaos/relocate.hpp>
+
+#include <boost/assert.hpp>
+#include <boost/mp11/algorithm.hpp>
+#include <boost/mp11/bind.hpp>
+#include <boost/mp11/list.hpp>
+#include <boost/mp11/utility.hpp>
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+namespace xaos {
+namespace detail {
+
+
+template <class Callable>
+struct inplace_holder {
+  using value_type = Callable;
+
+  auto value() noexcept -> Callable& { return object; }
+  auto value() const noexcept -> Callable const& { return object; }
+
+  Callable object;
+};
+
+template <class Callable>
+struct inplace_type {};
+
+
+template <class Overload>
+struct inplace_call_entry;
+
+template <class R, class... Args, bool NoExcept>
+struct inplace_call_entry<R(Args...) & noexcept(NoExcept)> {
+  template <class Callable>
+  constexpr explicit inplace_call_entry(inplace_type<Callable>) noexcept
+    : call_l([](void* obj, Args... args) noexcept(NoExcept) -> R {
+      auto& holder = *static_cast<inplace_holder<Callable>*>(obj);
+      return forward_to_callable<R, NoExcept, Args...>(
+        holder, static_cast<Args&&>(args)...);
+    }) {}
+
+  R (*call_l)(void*, Args...) noexcept(NoExcept);
+};
+
+template <class R, class... Args, bool NoExcept>
+struct inplace_call_entry<R(Args...) const& noexcept(NoExcept)> {
+  template <class Callable>
+  constexpr explicit inplace_call_entry(inplace_type<Callable>) noexcept
+    : call_cl([](void const* obj, Args... args) noexcept(NoExcept) -> R {
+      auto& holder = *static_cast<inplace_holder<Callable> const*>(obj);
+      return forward_to_callable<R, NoExcept, Args...>(
+        holder, static_cast<Args&&>(args)...);
+    }) {}
+
+  R (*call_cl)(void const*, Args...) noexcept(NoExcept);
+};
+
+template <class R, class... Args, bool NoExcept>
+struct inplace_call_entry<R(Args...) && noexcept(NoExcept)> {
+  template <class Callable>
+  constexpr explicit inplace_call_entry(inplace_type<Callable>) noexcept
+    : call_r([](void* obj, Args... args) noexcept(NoExcept) -> R {
+      auto& holder = *static_cast<inplace_holder<Callable>*>(obj);
+      return forward_to_callable<R, NoExcept, Args...>(
+        std::move(holder), static_cast<Args&&>(args)...);
+    }) {}
+
+  R (*call_r)(void*, Args...) noexcept(NoExcept);
+};
+
+template <class R, class... Args, bool NoExcept>
+struct inplace_call_entry<R(Args...) const&& noexcept(NoExcept)> {
+  template <class Callable>
+  constexpr explicit inplace_call_entry(inplace_type<Callable>) noexcept
+    : call_cr([](void const* obj, Args... args) noexcept(NoExcept) -> R {
+      auto& holder = *static_cast<inplace_holder<Callable> const*>(obj);
+      return forward_to_callable<R, NoExcept, Args...>(
+        std::move(holder), static_cast<Args&&>(args)...);
+    }) {}
+
+  R (*call_cr)(void const*, Args...) noexcept(NoExcept);
+};
+
+
+template <class Overload, class = void>
+struct inplace_bulk_entry {
+  template <class Callable>
+  constexpr explicit inplace_bulk_entry(inplace_type<Callable>) noexcept {}
+};
+
+template <class R, class... Args, bool NoExcept>
+struct inplace_bulk_entry<
+  R(Args...) & noexcept(NoExcept),
+  std::enable_if_t<is_bulk_invocable<R>::value>> {
+  template <class Callable>
+  constexpr explicit inplace_bulk_entry(inplace_type<Callable>) noexcept
+    : call_l_bulk([](
+                    void* obj,
+                    std::size_t n,
+                    bulk_result_pointer<R> out,
+                    bulk_argument<Args>*... in) noexcept(NoExcept) {
+      auto& holder = *static_cast<inplace_holder<Callable>*>(obj);
+      bulk_forward_to_callable<R, NoExcept, Args...>(holder, n, out, in...);
+    }) {}
+
+  void (*call_l_bulk)(
+    void*,
+    std::size_t,
+    bulk_result_pointer<R>,
+    bulk_argument<Args>*...) noexcept(NoExcept);
+};
+
+template <class R, class... Args, bool NoExcept>
+struct inplace_bulk_entry<
+  R(Args...) const& noexcept(NoExcept),
+  std::enable_if_t<is_bulk_invocable<R>::value>> {
+  template <class Callable>
+  constexpr explicit inplace_bulk_entry(inplace_type<Callable>) noexcept
+    : call_cl_bulk([](
+                     void const* obj,
+                     std::size_t n,
+                     bulk_result_pointer<R> out,
+                     bulk_argument<Args>*... in) noexcept(NoExcept) {
+      auto& holder = *static_cast<inplace_holder<Callable> const*>(obj);
+      bulk_forward_to_callable<R, NoExcept, Args...>(holder, n, out, in...);
+    }) {}
+
+  void (*call_cl_bulk)(
+    void const*,
+    std::size_t,
+    bulk_result_pointer<R>,
+    bulk_argument<Args>*...) noexcept(NoExcept);
+};
+
+
+template <class Callable>
+void relocate_inplace(void* to, void* from) noexcept {
+  auto& source = *static_cast<inplace_holder<Callable>*>(from);
+  ::new (to) inplace_holder<Callable>{std::move(source.object)};
+  source.~inplace_holder<Callable>();
+}
+
+template <class Callable>
+void copy_inplace(void* to, void const* from) {
+  auto& source = *static_cast<inplace_holder<Callable> const*>(from);
+  ::new (to) inplace_holder<Callable>{source.object};
+}
+
+template <class Callable>
+void destroy_inplace(void* obj) noexcept {
+  static_cast<inplace_holder<Callable>*>(obj)->~inplace_holder<Callable>();
+}
+
+
+// A table of plain function pointers, one object per callable type.
+// Operations which amount to copying bytes or doing nothing are null.
+template <class Overloads, class BulkOverloads>
+struct inplace_vtable;
+
+template <class... Overloads, class... BulkOverloads>
+struct inplace_vtable<
+  boost::mp11::mp_list<Overloads...>,
+  boost::mp11::mp_list<BulkOverloads...>>
+  : inplace_call_entry<Overloads>...
+  , inplace_bulk_entry<BulkOverloads>... {
+  template <class Callable>
+  constexpr explicit inplace_vtable(inplace_type<Callable> type) noexcept
+    : inplace_call_entry<Overloads>(type)...
+    , inplace_bulk_entry<BulkOverloads>(type)...
+    , relocate(
+        is_trivially_relocatable<Callable>::value
+          ? nullptr
+          : &relocate_inplace<Callable>)
+    , copy(copy_for<Callable>())
+    , destroy(
+        std::is_trivially_destructible<Callable>::value
+          ? nullptr
+          : &destroy_inplace<Callable>) {}
+
+  void (*relocate)(void* to, void* from) noexcept;
+  void (*copy)(void* to, void const* from);
+  void (*destroy)(void* obj) noexcept;
+
+private:
+  template <class Callable>
+  static constexpr auto copy_for() noexcept -> void (*)(void*, void const*) {
+    if constexpr (
+      std::is_trivially_copyable<Callable>::value
+      || !std::is_copy_constructible<Callable>::value) {
+      return nullptr;
+    } else {
+      return &copy_inplace<Callable>;
+    }
+  }
+};
+
+template <class Vtable, class Callable>
+inline constexpr Vtable inplace_vtable_for{inplace_type<Callable>()};
+
+
+template <class Derived, class Base, class Overload>
+struct inplace_call_overload;
+
+template <class Derived, class Base, class R, class... Args, bool NoExcept>
+struct inplace_call_overload<Derived, Base, R(Args...) & noexcept(NoExcept)>
+  : Base {
+  auto call_l(Args... args) noexcept(NoExcept) -> R {
+    auto& self = static_cast<Derived&>(*this);
+    return self.vtable_->call_l(self.buffer_, static_cast<Args&&>(args)...);
+  }
+};
+
+template <class Derived, class Base, class R, class... Args, bool NoExcept>
+struct inplace_call_overload<
+  Derived,
+  Base,
+  R(Args...) const& noexcept(NoExcept)> : Base {
+  auto call_cl(Args... args) const noexcept(NoExcept) -> R {
+    auto& self = static_cast<Derived const&>(*this);
+    return self.vtable_->call_cl(self.buffer_, static_cast<Args&&>(args)...);
+  }
+};
+
+template <class Derived, class Base, class R, class... Args, bool NoExcept>
+struct inplace_call_overload<Derived, Base, R(Args...) && noexcept(NoExcept)>
+  : Base {
+  auto call_r(Args... args) noexcept(NoExcept) -> R {
+    auto& self = static_cast<Derived&>(*this);
+    return self.vtable_->call_r(self.buffer_, static_cast<Args&&>(args)...);
+  }
+};
+
+template <class Derived, class Base, class R, class... Args, bool NoExcept>
+struct inplace_call_overload<
+  Derived,
+  Base,
+  R(Args...) const&& noexcept(NoExcept)> : Base {
+  auto call_cr(Args... args) const noexcept(NoExcept) -> R {
+    auto& self = static_cast<Derived const&>(*this);
+    return self.vtable_->call_cr(self.buffer_, static_cast<Args&&>(args)...);
+  }
+};
+
+
+template <class Derived, class Base, class Overload, class = void>
+struct inplace_bulk_call_overload : Base {};
+
+template <class Derived, class Base, class R, class... Args, bool NoExcept>
+struct inplace_bulk_call_overload<
+  Derived,
+  Base,
+  R(Args...) & noexcept(NoExcept),
+  std::enable_if_t<is_bulk_invocable<R>::value>> : Base {
+  void call_l_bulk(
+    std::size_t n,
+    bulk_result_pointer<R> out,
+    bulk_argument<Args>*... in) noexcept(NoExcept) {
+    auto& self = static_cast<Derived&>(*this);
+    self.vtable_->call_l_bulk(self.buffer_, n, out, in...);
+  }
+};
+
+template <class Derived, class Base, class R, class... Args, bool NoExcept>
+struct inplace_bulk_call_overload<
+  Derived,
+  Base,
+  R(Args...) const& noexcept(NoExcept),
+  std::enable_if_t<is_bulk_invocable<R>::value>> : Base {
+  void call_cl_bulk(
+    std::size_t n,
+    bulk_result_pointer<R> out,
+    bulk_argument<Args>*... in) const noexcept(NoExcept) {
+    auto& self = static_cast<Derived const&>(*this);
+    self.vtable_->call_cl_bulk(self.buffer_, n, out, in...);
+  }
+};
+
+
+struct inplace_storage_base {};
+
+// Stores the callable in a buffer of Capacity bytes inside the object. The
+// storage acts as its own backend pointer, so that the parentheses operators
+// of basic_function can be reused.
+template <class Signature, class Traits, std::size_t Capacity>
+class inplace_storage
+  : public boost::mp11::mp_fold_q<
+      bulk_overloads<Signature, Traits>,
+      boost::mp11::mp_fold_q<
+        enabled_overloads<Signature, Traits>,
+        inplace_storage_base,
+        boost::mp11::mp_bind_front<
+          inplace_call_overload,
+          inplace_storage<Signature, Traits, Capacity>>>,
+      boost::mp11::mp_bind_front<
+        inplace_bulk_call_overload,
+        inplace_storage<Signature, Traits, Capacity>>>
+{
+  template <class, class, class>
+  friend struct inplace_call_overload;
+  template <class, class, class, class>
+  friend struct inplace_bulk_call_overload;
+
+public:
+  using vtable_type = inplace_vtable<
+    enabled_overloads<Signature, Traits>,
+    bulk_overloads<Signature, Traits>>;
+
+  template <class Callable>
+  explicit inplace_storage(Callable callable) {
+    using holder = inplace_holder<Callable>;
+    static_assert(
+      sizeof(holder) <= Capacity,
+      "the callable does not fit into the inplace function");
+    static_assert(
+      alignof(holder) <= alignof(std::max_align_t),
+      "the callable is over-aligned");
+    static_assert(
+      std::is_nothrow_move_constructible<Callable>::value,
+      "the callable must be nothrow move constructible");
+    static_assert(
+      !is_copyability_enabled<Traits>::value
+        || std::is_copy_constructible<Callable>::value,
+      "the callable must be copy constructible");
+
+    ::new (static_cast<void*>(buffer_)) holder{std::move(callable)};
+    vtable_ = &inplace_vtable_for<vtable_type, Callable>;
+  }
+
+  inplace_storage(inplace_storage&& other) noexcept { take(other); }
+
+  auto operator=(inplace_storage&& other) noexcept -> inplace_storage& {
+    if (this != &other) {
+      reset();
+      take(other);
+    }
+    return *this;
+  }
+
+  ~inplace_storage() { reset(); }
+
+  void swap(inplace_storage& other) noexcept {
+    auto temp = std::move(other);
+    other = std::move(*this);
+    *this = std::move(temp);
+  }
+
+  auto empty() const noexcept -> bool { return !vtable_; }
+
+  auto operator->() noexcept -> inplace_storage* {
+    BOOST_ASSERT(vtable_);
+    return this;
+  }
+
+  auto operator->() const noexcept -> inplace_storage const* {
+    BOOST_ASSERT(vtable_);
+    return this;
+  }
+
+protected:
+  inplace_storage() noexcept = default;
+
+  void copy_from(inplace_storage const& other) {
+    if (!other.vtable_) { return; }
+    if (other.vtable_->copy) {
+      other.vtable_->copy(buffer_, other.buffer_);
+    } else {
+      std::memcpy(buffer_, other.buffer_, Capacity);
+    }
+    vtable_ = other.vtable_;
+  }
+
+private:
+  void take(inplace_storage& other) noexcept {
+    if (!other.vtable_) { return; }
+    if (other.vtable_->relocate) {
+      other.vtable_->relocate(buffer_, other.buffer_);
+    } else {
+      std::memcpy(buffer_, other.buffer_, Capacity);
+    }
+    vtable_ = std::exchange(other.vtable_, nullptr);
+  }
+
+  void reset() noexcept {
+    if (vtable_ && vtable_->destroy) { vtable_->destroy(buffer_); }
+    vtable_ = nullptr;
+  }
+
+  vtable_type const* vtable_ = nullptr;
+  alignas(std::max_align_t) unsigned char buffer_[Capacity];
+};
+
+
+template <class Signature, class Traits, std::size_t Capacity>
+class copyable_inplace_storage
+  : public inplace_storage<Signature, Traits, Capacity>
+{
+  using base_t = inplace_storage<Signature, Traits, Capacity>;
+
+public:
+  using base_t::base_t;
+
+  copyable_inplace_storage(copyable_inplace_storage&&) = default;
+  auto operator=(copyable_inplace_storage&&)
+    -> copyable_inplace_storage& = default;
+
+  copyable_inplace_storage(copyable_inplace_storage const& other)
+    : base_t() {
+    this->copy_from(other);
+  }
+
+  auto operator=(copyable_inplace_storage const& other)
+    -> copyable_inplace_storage& {
+    if (this != &other) {
+      auto temp = copyable_inplace_storage(other);
+      *this = std::move(temp);
+    }
+    return *this;
+  }
+};
+
+
+template <class Signature, class Traits, std::size_t Capacity>
+using inplace_storage_for = boost::mp11::mp_if<
+  is_copyability_enabled<Traits>,
+  copyable_inplace_storage<Signature, Traits, Capacity>,
+  inplace_storage<Signature, Traits, Capacity>>;
+
+
+template <
+  class Signature,
+  class Traits,
+  class Capacity,
+  class... Overloads>
+class basic_inplace_function
+  : parens_overload<
+      basic_inplace_function<Signature, Traits, Capacity, Overloads...>,
+      are_rvalue_overloads_enabled<Traits>::value,
+      Overloads>...
+{
+private:
+  template <class, bool, class>
+  friend struct parens_overload;
+
+  using storage_t = inplace_storage_for<Signature, Traits, Capacity::value>;
+  storage_t storage_;
+
+  static constexpr bool consumes_on_call
+    = is_consume_on_call_enabled<Traits>::value;
+
+  static constexpr bool bulk_call_enabled
+    = is_bulk_call_enabled<Traits>::value;
+
+  // nothing is allocated, the callable is destroyed on return
+  template <class R, class... Args>
+  static auto consume(storage_t& storage, Args... args) -> R {
+    auto consumed = std::move(storage);
+    return consumed->call_r(static_cast<Args&&>(args)...);
+  }
+
+public:
+  static constexpr std::size_t capacity = Capacity::value;
+
+  template <class Callable>
+  basic_inplace_function(Callable callable)
+    : storage_(std::move(callable)) {}
+
+  using parens_overload<
+    basic_inplace_function<Signature, Traits, Capacity, Overloads...>,
+    are_rvalue_overloads_enabled<Traits>::value,
+    Overloads>::operator()...;
+
+  using parens_overload<
+    basic_inplace_function<Signature, Traits, Capacity, Overloads...>,
+    are_rvalue_overloads_enabled<Traits>::value,
+    Overloads>::invoke_bulk...;
+
+  explicit operator bool() const noexcept { return !storage_.empty(); }
+
+  void swap(basic_inplace_function& other) noexcept {
+    storage_.swap(other.storage_);
+  }
+};
+
+
+template <
+  class Signature,
+  class Traits,
+  class Capacity,
+  class... Overloads>
+void swap(
+  basic_inplace_function<Signature, Traits, Capacity, Overloads...>& l,
+  basic_inplace_function<Signature, Traits, Capacity, Overloads...>&
+    r) noexcept {
+  l.swap(r);
+}
+
+
+} // namespace detail
+} // namespace xaos
+
+
+#endif // XAOS_DETAIL_INPLACE_FUNCTION_HPP
@@ -0,0 +1,121 @@
+#ifndef XAOS_DETAIL_LRU_CACHE_HPP
+#define XAOS_DETAIL_LRU_CACHE_HPP
+
+
+#include <boost/assert.hpp>
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+
+namespace xaos {
+namespace detail {
+
+
+template <class Key, class Hash>
+struct key_ref_hash : Hash {
+  key_ref_hash(Hash hash) : Hash(std::move(hash)) {}
+
+  auto operator()(std::reference_wrapper<Key const> key) const
+    -> std::size_t {
+    return Hash::operator()(key.get());
+  }
+};
+
+template <class Key>
+struct key_ref_equal {
+  auto operator()(
+    std::reference_wrapper<Key const> l,
+    std::reference_wrapper<Key const> r) const -> bool {
+    return l.get() == r.get();
+  }
+};
+
+
+// Bounded cache which evicts the least recently used entry. Entries are kept
+// in a list ordered by recency, the index refers to keys stored in the list
+// nodes, so every key is stored exactly once. All nodes are obtained from the
+// provided allocator.
+template <class Key, class Value, class Hash, class Allocator>
+class lru_cache
+{
+private:
+  struct entry {
+    Key key;
+    Value value;
+  };
+
+  using proto_traits = std::allocator_traits<Allocator>;
+  using entry_allocator = typename proto_traits::template rebind_alloc<entry>;
+  using entry_list = std::list<entry, entry_allocator>;
+  using entry_iterator = typename entry_list::iterator;
+
+  using key_ref = std::reference_wrapper<Key const>;
+  using index_allocator = typename proto_traits::template rebind_alloc<
+    std::pair<key_ref const, entry_iterator>>;
+  using entry_index = std::unordered_map<
+    key_ref,
+    entry_iterator,
+    key_ref_hash<Key, Hash>,
+    key_ref_equal<Key>,
+    index_allocator>;
+
+public:
+  lru_cache(std::size_t capacity, Allocator const& alloc)
+    : entries_(entry_allocator(alloc))
+    , index_(
+        capacity,
+        key_ref_hash<Key, Hash>(Hash()),
+        key_ref_equal<Key>(),
+        index_allocator(alloc))
+    , capacity_(capacity) {
+    BOOST_ASSERT(capacity > 0);
+  }
+
+  auto find(Key const& key) -> Value const* {
+    auto const it = index_.find(std::cref(key));
+    if (it == index_.end()) { return nullptr; }
+
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return std::addressof(it->second->value);
+  }
+
+  void insert(Key key, Value value) {
+    if (find(key)) { return; }
+
+    if (index_.size() == capacity_) {
+      index_.erase(std::cref(entries_.back().key));
+      entries_.pop_back();
+    }
+
+    entries_.push_front(entry{std::move(key), std::move(value)});
+    try {
+      index_.emplace(std::cref(entries_.front().key), entries_.begin());
+    } catch (...) {
+      entries_.pop_front();
+      throw;
+    }
+  }
+
+  void clear() noexcept {
+    index_.clear();
+    entries_.clear();
+  }
+
+  auto size() const noexcept -> std::size_t { return index_.size(); }
+  auto capacity() const noexcept -> std::size_t { return capacity_; }
+
+private:
+  entry_list entries_;
+  entry_index index_;
+  std::size_t capacity_;
+};
+
+
+} // namespace detail
+} // namespace xaos
+
+
+#endif // XAOS_DETAIL_LRU_CACHE_HPP
@@ -0,0 +1,203 @@
+#ifndef XAOS_DETAIL_MEMOIZED_FUNCTION_HPP
+#define XAOS_DETAIL_MEMOIZED_FUNCTION_HPP
+
+
+#include <xaos/detail/lru_cache.hpp>
+#include <xaos/function.hpp>
+
+#include <boost/assert.hpp>
+#include <boost/container_hash/hash.hpp>
+#include <boost/mp11/integral.hpp>
+#include <boost/mp11/utility.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+
+
+namespace xaos {
+namespace detail {
+
+
+template <class Traits>
+using concurrency_enabled_helper = boost::mp11::mp_bool<Traits::is_concurrent>;
+
+template <class Traits>
+using is_concurrency_enabled = boost::mp11::
+  mp_eval_or<boost::mp11::mp_false, concurrency_enabled_helper, Traits>;
+
+
+template <class Traits>
+using shard_count_helper
+  = std::integral_constant<std::size_t, Traits::shard_count>;
+
+template <class Traits>
+using shard_count = boost::mp11::mp_eval_or<
+  std::integral_constant<std::size_t, 1>,
+  shard_count_helper,
+  Traits>;
+
+
+struct null_mutex {
+  void lock() noexcept {}
+  void unlock() noexcept {}
+};
+
+
+template <class Cache, class Mutex>
+struct memo_shard {
+  template <class Allocator>
+  memo_shard(std::size_t capacity, Allocator const& alloc)
+    : cache(capacity, alloc) {}
+
+  Mutex mutex;
+  Cache cache;
+  std::size_t hits = 0;
+  std::size_t misses = 0;
+};
+
+
+template <class Signature, class Traits, class Allocator>
+class basic_memoized_function;
+
+template <class R, class... Args, class Traits, class Allocator>
+class basic_memoized_function<R(Args...), Traits, Allocator>
+{
+private:
+  static constexpr bool is_concurrent
+    = is_concurrency_enabled<Traits>::value;
+  static constexpr std::size_t shards = shard_count<Traits>::value;
+  static_assert(shards > 0 && (shards & (shards - 1)) == 0);
+  static_assert(is_concurrent || shards == 1);
+  // results are returned from copies, as cached ones may be evicted
+  static_assert(std::is_object<R>::value && !std::is_array<R>::value);
+
+  using key_type = std::tuple<std::decay_t<Args>...>;
+  using result_type = std::decay_t<R>;
+  using cache_type
+    = lru_cache<key_type, result_type, boost::hash<key_type>, Allocator>;
+  using mutex_type = std::conditional_t<is_concurrent, std::mutex, null_mutex>;
+  using shard_type = memo_shard<cache_type, mutex_type>;
+
+public:
+  // in concurrent mode the wrapped function is invoked outside of locks,
+  // so it is required to be callable through a const reference
+  using function_type = std::conditional_t<
+    is_concurrent,
+    xaos::const_function<R(Args...), Allocator>,
+    xaos::function<R(Args...), Allocator>>;
+  using allocator_type = typename function_type::allocator_type;
+
+  template <class Callable>
+  basic_memoized_function(
+    Callable callable, std::size_t capacity, Allocator alloc = Allocator())
+    : basic_memoized_function(
+      function_type(std::move(callable), alloc),
+      capacity,
+      std::make_index_sequence<shards>()) {}
+
+  auto operator()(Args... args) -> R {
+    auto key = key_type(args...);
+    auto const hash = boost::hash<key_type>()(key);
+    auto& shard = shards_[shard_index(hash)];
+
+    {
+      auto lock = std::unique_lock<mutex_type>(shard.mutex);
+      if (auto const found = shard.cache.find(key)) {
+        ++shard.hits;
+        return *found;
+      }
+      ++shard.misses;
+    }
+
+    auto result = result_type(func_(static_cast<Args&&>(args)...));
+
+    auto lock = std::unique_lock<mutex_type>(shard.mutex);
+    shard.cache.insert(std::move(key), result);
+    return result;
+  }
+
+  auto hits() const -> std::size_t {
+    return accumulate([](shard_type const& shard) { return shard.hits; });
+  }
+
+  auto misses() const -> std::size_t {
+    return accumulate([](shard_type const& shard) { return shard.misses; });
+  }
+
+  auto size() const -> std::size_t {
+    return accumulate(
+      [](shard_type const& shard) { return shard.cache.size(); });
+  }
+
+  void clear() {
+    for (auto& shard : shards_) {
+      auto lock = std::unique_lock<mutex_type>(shard.mutex);
+      shard.cache.clear();
+    }
+  }
+
+  auto get_allocator() const -> allocator_type {
+    return func_.get_allocator();
+  }
+
+private:
+  template <std::size_t... I>
+  basic_memoized_function(
+    function_type func, std::size_t capacity, std::index_sequence<I...>)
+    : func_(std::move(func))
+    , shard_bits_(used_shard_bits(capacity))
+    , shards_{{shard_type(
+        shard_capacity(capacity, shard_bits_, I), func_.get_allocator())...}} {
+  }
+
+  // Only as many shards are used as there are entries, and the capacity is
+  // split exactly between them, so that the cache never holds more than
+  // capacity results. Shards past the used ones stay empty.
+  static auto used_shard_bits(std::size_t capacity) noexcept -> unsigned {
+    BOOST_ASSERT(capacity > 0);
+    auto bits = 0u;
+    while ((std::size_t(2) << bits) <= std::min(capacity, shards)) { ++bits; }
+    return bits;
+  }
+
+  static auto shard_capacity(
+    std::size_t capacity, unsigned bits, std::size_t index) noexcept
+    -> std::size_t {
+    auto const used = std::size_t(1) << bits;
+    if (index >= used) { return 1; }
+    return capacity / used + (index < capacity % used);
+  }
+
+  auto shard_index(std::size_t hash) const noexcept -> std::size_t {
+    if (!shard_bits_) { return 0; }
+    // Fibonacci hashing, so that shards do not correlate with buckets
+    constexpr auto multiplier = std::uint64_t(11400714819323198485ull);
+    return static_cast<std::size_t>(
+      (std::uint64_t(hash) * multiplier) >> (64 - shard_bits_));
+  }
+
+  template <class Projection>
+  auto accumulate(Projection proj) const -> std::size_t {
+    auto result = std::size_t(0);
+    for (auto& shard : shards_) {
+      auto lock = std::unique_lock<mutex_type>(shard.mutex);
+      result += proj(shard);
+    }
+    return result;
+  }
+
+  function_type func_;
+  unsigned shard_bits_;
+  mutable std::array<shard_type, shards> shards_;
+};
+
+
+} // namespace detail
+} // namespace xaos
+
+
+#endif // XAOS_DETAIL_MEMOIZED_FUNCTION_HPP
@@ -0,0 +1,76 @@
+#ifndef XAOS_DETAIL_MPSC_QUEUE_HPP
+#define XAOS_DETAIL_MPSC_QUEUE_HPP
+
+
+#include <atomic>
+
+
+namespace xaos {
+namespace detail {
+
+
+struct mpsc_hook {
+  std::atomic<mpsc_hook*> next{nullptr};
+};
+
+
+// Intrusive lock-free multi-producer single-consumer queue after
+// Dmitry Vyukov. Pushing is wait-free, popping may observe a push that is in
+// progress, in which case pop returns nullptr while empty returns false.
+class mpsc_queue
+{
+public:
+  mpsc_queue() noexcept : head_(&stub_), tail_(&stub_) {}
+
+  mpsc_queue(mpsc_queue const&) = delete;
+  auto operator=(mpsc_queue const&) -> mpsc_queue& = delete;
+
+  void push(mpsc_hook& node) noexcept {
+    node.next.store(nullptr, std::memory_order_relaxed);
+    auto const prev = head_.exchange(&node, std::memory_order_seq_cst);
+    prev->next.store(&node, std::memory_order_release);
+  }
+
+  auto pop() noexcept -> mpsc_hook* {
+    auto tail = tail_;
+    auto next = tail->next.load(std::memory_order_acquire);
+    if (tail == &stub_) {
+      if (!next) { return nullptr; }
+      tail_ = next;
+      tail = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+
+    if (next) {
+      tail_ = next;
+      return tail;
+    }
+
+    if (tail != head_.load(std::memory_order_acquire)) { return nullptr; }
+
+    push(stub_);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next) {
+      tail_ = next;
+      return tail;
+    }
+    return nullptr;
+  }
+
+  auto empty() const noexcept -> bool {
+    return head_.load(std::memory_order_seq_cst) == &stub_
+           && !stub_.next.load(std::memory_order_acquire);
+  }
+
+private:
+  std::atomic<mpsc_hook*> head_;
+  mpsc_hook* tail_;
+  mpsc_hook stub_;
+};
+
+
+} // namespace detail
+} // namespace xaos
+
+
+#endif // XAOS_DETAIL_MPSC_QUEUE_HPP
@@ -0,0 +1,131 @@
+#ifndef XAOS_DETAIL_PERFECT_HASH_HPP
+#define XAOS_DETAIL_PERFECT_HASH_HPP
+
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+
+namespace xaos {
+namespace detail {
+
+
+inline auto mix_hash(std::uint64_t h) noexcept -> std::uint64_t {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ull;
+  h ^= h >> 33;
+  return h;
+}
+
+// maps a uniformly distributed value to [0, n) without a division
+inline auto reduce_hash(std::uint64_t h, std::size_t n) noexcept
+  -> std::size_t {
+  return static_cast<std::size_t>(((h >> 32) * std::uint64_t(n)) >> 32);
+}
+
+
+// Minimal perfect hash function over a frozen set of hash values after the
+// hash and displace scheme. Values are first distributed into buckets, then
+// for every bucket, largest first, a displacement is searched which maps all
+// its values to slots that are still free.
+class perfect_hash
+{
+public:
+  perfect_hash() = default;
+
+  // Returns the slot of every hash value. Throws std::invalid_argument if
+  // the values contain duplicates.
+  auto build(std::vector<std::uint64_t> const& hashes)
+    -> std::vector<std::size_t> {
+    auto sorted = hashes;
+    std::sort(sorted.begin(), sorted.end());
+    if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end()) {
+      throw std::invalid_argument("xaos: duplicate hash values");
+    }
+
+    auto const n = hashes.size();
+    slot_count_ = n;
+    displacements_.assign(std::max(n / 2, std::size_t(1)), 0);
+
+    auto buckets = std::vector<std::vector<std::size_t>>(
+      displacements_.size());
+    for (std::size_t i = 0; i != n; ++i) {
+      buckets[bucket(hashes[i])].push_back(i);
+    }
+
+    auto order = std::vector<std::size_t>(buckets.size());
+    std::iota(order.begin(), order.end(), std::size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&](auto l, auto r) {
+      return buckets[l].size() > buckets[r].size();
+    });
+
+    auto slots = std::vector<std::size_t>(n);
+    auto taken = std::vector<bool>(n);
+    auto candidate = std::vector<std::size_t>();
+    for (auto const b : order) {
+      auto const& members = buckets[b];
+      if (members.empty()) { break; }
+
+      for (std::uint32_t d = 1;; ++d) {
+        // distinct values are separated with overwhelming probability long
+        // before this
+        if (d == max_attempts) {
+          throw std::invalid_argument("xaos: no perfect hash found");
+        }
+
+        candidate.clear();
+        for (auto const i : members) {
+          auto const s = slot(hashes[i], d);
+          if (taken[s]
+              || std::find(candidate.begin(), candidate.end(), s)
+                   != candidate.end()) {
+            break;
+          }
+          candidate.push_back(s);
+        }
+        if (candidate.size() != members.size()) { continue; }
+
+        displacements_[b] = d;
+        for (std::size_t k = 0; k != members.size(); ++k) {
+          taken[candidate[k]] = true;
+          slots[members[k]] = candidate[k];
+        }
+        break;
+      }
+    }
+    return slots;
+  }
+
+  auto operator()(std::uint64_t hash) const noexcept -> std::size_t {
+    return slot(hash, displacements_[bucket(hash)]);
+  }
+
+private:
+  static constexpr std::uint32_t max_attempts = 1u << 20;
+
+  auto bucket(std::uint64_t hash) const noexcept -> std::size_t {
+    return reduce_hash(mix_hash(hash), displacements_.size());
+  }
+
+  auto slot(std::uint64_t hash, std::uint32_t displacement) const noexcept
+    -> std::size_t {
+    return reduce_hash(
+      mix_hash(hash ^ (displacement * 0x9e3779b97f4a7c15ull)), slot_count_);
+  }
+
+  std::size_t slot_count_ = 0;
+  std::vector<std::uint32_t> displacements_;
+};
+
+
+} // namespace detail
+} // namespace xaos
+
+
+#endif // XAOS_DETAIL_PERFECT_HASH_HPP
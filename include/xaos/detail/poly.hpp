@@ -0,0 +1,410 @@
+#ifndef XAOS_DETAIL_POLY_HPP
+#define XAOS_DETAIL_POLY_HPP
+
+
+#include <xaos/detail/backend_pointer.hpp>
+#include <xaos/detail/function_alloc.hpp>
+#include <xaos/detail/reclamation.hpp>
+
+#include <boost/assert.hpp>
+#include <boost/core/empty_value.hpp>
+#include <boost/mp11/algorithm.hpp>
+#include <boost/mp11/function.hpp>
+#include <boost/mp11/list.hpp>
+#include <boost/mp11/utility.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+namespace xaos {
+namespace detail {
+
+
+template <class Interface, class Traits>
+struct poly_backend_interface
+  : alloc_interface
+  , boost::mp11::mp_apply<
+      boost::mp11::mp_inherit,
+      boost::mp11::mp_append<
+        maybe_clone_interface<Traits>,
+        maybe_thin_interface<Traits>,
+        maybe_deferred_interface<Traits>,
+        maybe_inline_interface<Traits>,
+        boost::mp11::mp_list<Interface>>> {
+  using interface = Interface;
+  using traits = Traits;
+};
+
+
+// Backends of thin handles and of deferred ones outlive the allocator of their
+// handle, so they keep a copy of it.
+template <class Traits>
+using stores_allocator = boost::mp11::mp_or<
+  is_thin_handle_enabled<Traits>,
+  is_deferred_destruction_enabled<Traits>>;
+
+
+// Stores a value of type Value and implements Interface for it with
+// Interface::implementation, which reaches the value through value().
+template <class BackendInterface, class Allocator, class Value>
+struct poly_backend final
+  : BackendInterface::interface::template implementation<
+      poly_backend<BackendInterface, Allocator, Value>,
+      maybe_inline_implementation<
+        typename BackendInterface::traits,
+        poly_backend<BackendInterface, Allocator, Value>,
+        maybe_deferred_implementation<
+          typename BackendInterface::traits,
+          poly_backend<BackendInterface, Allocator, Value>,
+          maybe_thin_implementation<
+            typename BackendInterface::traits,
+            poly_backend<BackendInterface, Allocator, Value>,
+            maybe_clone_implementation<
+              typename BackendInterface::traits,
+              poly_backend<BackendInterface, Allocator, Value>,
+              BackendInterface>>>>>
+  , boost::empty_value<Value, 0>
+  , pointer_storage_helper<
+      poly_backend<BackendInterface, Allocator, Value>,
+      Allocator,
+      1>
+  , allocator_storage<
+      Allocator,
+      2,
+      stores_allocator<typename BackendInterface::traits>::value>
+  , aligned_base<
+      backend_alignment<typename BackendInterface::traits>::value> {
+  using allocator_type = Allocator;
+  using value_type = Value;
+  using interface_type = BackendInterface;
+  using pointer_holder_t = pointer_storage_helper<poly_backend, Allocator, 1>;
+  using allocator_holder_t = allocator_storage<
+    Allocator,
+    2,
+    stores_allocator<typename BackendInterface::traits>::value>;
+
+  // An allocator-aware value is given the allocator of the handle, so that
+  // its state lives in the same memory as the backend.
+  template <class Source>
+  poly_backend(
+    typename pointer_holder_t::pointer ptr,
+    Allocator const& proto_alloc,
+    Source&& value)
+    : boost::empty_value<Value, 0>(
+      boost::empty_init_t(),
+      make_using_allocator<Value>(proto_alloc, static_cast<Source&&>(value)))
+    , pointer_holder_t(std::move(ptr))
+    , allocator_holder_t(proto_alloc) {}
+
+  virtual auto relocate(void* type_erased_alloc) -> void* {
+    auto alloc
+      = restore_allocator<allocator_type, poly_backend>(type_erased_alloc);
+    auto const& proto_alloc
+      = *static_cast<allocator_type const*>(type_erased_alloc);
+    auto const raw_ptr = new_backend(alloc, proto_alloc, std::move(value()));
+    return static_cast<interface_type*>(raw_ptr);
+  };
+
+  virtual void delete_this(void* type_erased_alloc) {
+    auto alloc
+      = restore_allocator<allocator_type, poly_backend>(type_erased_alloc);
+    auto const ptr = this->pointer_to(*this);
+
+    using proto_traits = std::allocator_traits<Allocator>;
+    using alloc_traits =
+      typename proto_traits::template rebind_traits<poly_backend>;
+    alloc_traits::destroy(alloc, this);
+    alloc_traits::deallocate(alloc, ptr, 1);
+  };
+
+  auto value() noexcept -> Value& {
+    return boost::empty_value<Value, 0>::get();
+  }
+
+  auto value() const noexcept -> Value const& {
+    return boost::empty_value<Value, 0>::get();
+  }
+};
+
+
+template <class Traits, class Allocator>
+using backend_deleter_for = boost::mp11::mp_cond<
+  is_thin_handle_enabled<Traits>,
+  thin_backend_deleter<Allocator>,
+  is_deferred_destruction_enabled<Traits>,
+  deferred_backend_deleter<Allocator>,
+  boost::mp11::mp_true,
+  backend_deleter<Allocator>>;
+
+
+// Holds the backend in a buffer of Capacity::value bytes if it fits there and
+// the value can be moved without throwing and without an allocator, otherwise
+// allocates it. Moving an inline backend moves the value, so such moves are
+// never free, but they never allocate either.
+template <class BackendBase, class Allocator, class Capacity>
+class inline_backend_pointer : boost::empty_value<Allocator>
+{
+private:
+  using alloc_base = boost::empty_value<Allocator>;
+  using allocator_traits = std::allocator_traits<Allocator>;
+
+  template <class Backend, class Value>
+  using fits_inline = boost::mp11::mp_bool<
+    sizeof(Backend) <= Capacity::value
+    && alignof(Backend) <= alignof(std::max_align_t)
+    && std::is_nothrow_move_constructible<Value>::value
+    && !std::uses_allocator<Value, Allocator>::value>;
+
+public:
+  using backend_interface = BackendBase;
+  using allocator_type = Allocator;
+
+  template <class Value>
+  inline_backend_pointer(allocator_type alloc, Value value)
+    : alloc_base(boost::empty_init_t(), std::move(alloc)) {
+    using backend = poly_backend<BackendBase, Allocator, Value>;
+    auto const& proto_alloc = alloc_base::get();
+    if constexpr (fits_inline<backend, Value>::value) {
+      ptr_ = ::new (static_cast<void*>(buffer_))
+        backend(nullptr, proto_alloc, std::move(value));
+      inline_ = true;
+    } else {
+      using backend_traits =
+        typename allocator_traits::template rebind_traits<backend>;
+      auto backend_alloc
+        = typename backend_traits::allocator_type(proto_alloc);
+      ptr_ = new_backend(backend_alloc, proto_alloc, std::move(value));
+    }
+  }
+
+  inline_backend_pointer(inline_backend_pointer&& other) noexcept
+    : alloc_base(boost::empty_init_t(), other.alloc_base::get()) {
+    take(other);
+  }
+
+  // Moves an allocated backend into memory obtained from alloc unless the
+  // allocators are equal.
+  inline_backend_pointer(
+    std::allocator_arg_t, allocator_type alloc, inline_backend_pointer&& other)
+    : alloc_base(boost::empty_init_t(), std::move(alloc)) {
+    steal(other);
+  }
+
+  ~inline_backend_pointer() { reset(); }
+
+  auto operator=(inline_backend_pointer&& other) noexcept(
+    is_nothrow_move_assignable_with<allocator_type>::value)
+    -> inline_backend_pointer& {
+    if (this == &other) { return *this; }
+
+    reset();
+    if constexpr (is_nothrow_move_assignable_with<allocator_type>::value) {
+      if constexpr (allocator_traits::
+                      propagate_on_container_move_assignment::value) {
+        alloc_base::get() = other.alloc_base::get();
+      }
+      take(other);
+    } else {
+      steal(other);
+    }
+    return *this;
+  }
+
+  void swap(inline_backend_pointer& other) noexcept(
+    is_nothrow_swappable_with<allocator_type>::value) {
+    if constexpr (allocator_traits::propagate_on_container_swap::value) {
+      auto temp = inline_backend_pointer(std::move(other));
+      other.alloc_base::get() = alloc_base::get();
+      other.take(*this);
+      alloc_base::get() = temp.alloc_base::get();
+      take(temp);
+    } else {
+      auto temp = inline_backend_pointer(
+        std::allocator_arg, other.alloc_base::get(), std::move(*this));
+      steal(other);
+      other.take(temp);
+    }
+  }
+
+  auto get_allocator() const -> allocator_type { return alloc_base::get(); }
+
+  // Moves an allocated backend into memory obtained from alloc and releases
+  // the memory it used to occupy. Inline backends stay where they are.
+  void reallocate(allocator_type alloc) {
+    BOOST_ASSERT(ptr_);
+    if (!inline_) {
+      auto const impl_ptr = ptr_->relocate(std::addressof(alloc));
+      auto const iface_ptr = static_cast<backend_interface*>(impl_ptr);
+      reset();
+      ptr_ = iface_ptr;
+    }
+    alloc_base::get() = std::move(alloc);
+  }
+
+  auto empty() const noexcept -> bool { return !ptr_; }
+
+  // Whether the backend is stored in the buffer of the handle.
+  auto is_inline() const noexcept -> bool { return inline_; }
+
+  auto operator->() -> backend_interface* { return ptr_; }
+  auto operator->() const -> backend_interface const* { return ptr_; }
+
+  auto operator*() -> backend_interface& { return *ptr_; }
+  auto operator*() const -> backend_interface const& { return *ptr_; }
+
+protected:
+  explicit inline_backend_pointer(allocator_type alloc) noexcept
+    : alloc_base(boost::empty_init_t(), std::move(alloc)) {}
+
+  auto allocator_ref() noexcept -> allocator_type& {
+    return alloc_base::get();
+  }
+
+  void reset() noexcept {
+    if (!ptr_) { return; }
+
+    if (inline_) {
+      ptr_->destroy_inline();
+    } else {
+      auto alloc = alloc_base::get();
+      ptr_->delete_this(std::addressof(alloc));
+    }
+    ptr_ = nullptr;
+    inline_ = false;
+  }
+
+  // Takes over the backend of other, which must either be inline or use an
+  // allocator equal to the one of this handle.
+  void take(inline_backend_pointer& other) noexcept {
+    BOOST_ASSERT(!ptr_);
+    if (other.inline_) {
+      auto alloc = alloc_base::get();
+      auto const impl_ptr
+        = other.ptr_->move_inline(buffer_, std::addressof(alloc));
+      ptr_ = static_cast<backend_interface*>(impl_ptr);
+      inline_ = true;
+      other.ptr_ = nullptr;
+      other.inline_ = false;
+    } else {
+      ptr_ = std::exchange(other.ptr_, nullptr);
+    }
+  }
+
+  void steal(inline_backend_pointer& other) {
+    if (other.inline_ || alloc_base::get() == other.alloc_base::get()) {
+      take(other);
+    } else if (other.ptr_) {
+      auto alloc = alloc_base::get();
+      auto const impl_ptr = other.ptr_->relocate(std::addressof(alloc));
+      other.reset();
+      ptr_ = static_cast<backend_interface*>(impl_ptr);
+    }
+  }
+
+  void copy_from(inline_backend_pointer const& other) {
+    BOOST_ASSERT(!ptr_);
+    auto alloc = alloc_base::get();
+    if (other.inline_) {
+      auto const impl_ptr
+        = other.ptr_->clone_inline(buffer_, std::addressof(alloc));
+      ptr_ = static_cast<backend_interface*>(impl_ptr);
+      inline_ = true;
+    } else if (other.ptr_) {
+      auto const impl_ptr = other.ptr_->clone(std::addressof(alloc));
+      ptr_ = static_cast<backend_interface*>(impl_ptr);
+    }
+  }
+
+private:
+  backend_interface* ptr_ = nullptr;
+  bool inline_ = false;
+  alignas(std::max_align_t) unsigned char buffer_[Capacity::value];
+};
+
+
+template <class BackendBase, class Allocator, class Capacity>
+class copyable_inline_backend_pointer
+  : public inline_backend_pointer<BackendBase, Allocator, Capacity>
+{
+private:
+  using base_t = inline_backend_pointer<BackendBase, Allocator, Capacity>;
+
+public:
+  using allocator_type = typename base_t::allocator_type;
+
+  using base_t::base_t;
+
+  copyable_inline_backend_pointer(copyable_inline_backend_pointer&&)
+    = default;
+  auto operator=(copyable_inline_backend_pointer &&)
+    -> copyable_inline_backend_pointer& = default;
+
+  copyable_inline_backend_pointer(copyable_inline_backend_pointer const& other)
+    : base_t(std::allocator_traits<allocator_type>::
+               select_on_container_copy_construction(other.get_allocator())) {
+    this->copy_from(other);
+  }
+
+  copyable_inline_backend_pointer(
+    std::allocator_arg_t,
+    allocator_type alloc,
+    copyable_inline_backend_pointer&& other)
+    : base_t(std::allocator_arg, std::move(alloc), std::move(other)) {}
+
+  copyable_inline_backend_pointer(
+    std::allocator_arg_t,
+    allocator_type alloc,
+    copyable_inline_backend_pointer const& other)
+    : base_t(std::move(alloc)) {
+    this->copy_from(other);
+  }
+
+  auto operator=(copyable_inline_backend_pointer const& other)
+    -> copyable_inline_backend_pointer& {
+    using allocator_traits = std::allocator_traits<allocator_type>;
+    using propagate = boost::mp11::mp_bool<
+      allocator_traits::propagate_on_container_copy_assignment::value>;
+    auto const alloc = pick_allocator(
+      other.get_allocator(), this->get_allocator(), propagate());
+
+    auto temp
+      = copyable_inline_backend_pointer(std::allocator_arg, alloc, other);
+    this->reset();
+    this->allocator_ref() = alloc;
+    this->take(temp);
+    return *this;
+  }
+};
+
+
+template <class Interface, class Traits, class Allocator>
+using poly_storage = boost::mp11::mp_apply_q<
+  boost::mp11::mp_cond<
+    boost::mp11::mp_and<
+      is_inline_storage_enabled<Traits>,
+      is_copyability_enabled<Traits>>,
+    boost::mp11::mp_quote<copyable_inline_backend_pointer>,
+    is_inline_storage_enabled<Traits>,
+    boost::mp11::mp_quote<inline_backend_pointer>,
+    is_copyability_enabled<Traits>,
+    boost::mp11::mp_quote<copyable_backend_pointer>,
+    boost::mp11::mp_true,
+    boost::mp11::mp_quote<backend_pointer>>,
+  boost::mp11::mp_list<
+    poly_backend_interface<Interface, Traits>,
+    Allocator,
+    boost::mp11::mp_if<
+      is_inline_storage_enabled<Traits>,
+      inline_capacity<Traits>,
+      backend_deleter_for<Traits, Allocator>>>>;
+
+
+} // namespace detail
+} // namespace xaos
+
+
+#endif // XAOS_DETAIL_POLY_HPP
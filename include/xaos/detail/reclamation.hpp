@@ -0,0 +1,151 @@
+#ifndef XAOS_DETAIL_RECLAMATION_HPP
+#define XAOS_DETAIL_RECLAMATION_HPP
+
+
+#include <xaos/detail/backend_pointer.hpp>
+#include <xaos/detail/function_alloc.hpp>
+
+#include <boost/mp11/list.hpp>
+#include <boost/mp11/utility.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+
+namespace xaos {
+namespace detail {
+
+
+struct reclamation_node {
+  virtual void reclaim() noexcept = 0;
+
+  reclamation_node* next = nullptr;
+
+protected:
+  ~reclamation_node() = default;
+};
+
+
+// Lock-free stack of dead objects. Any thread can push, collect takes the
+// whole stack at once and reclaims the objects in the order they were pushed.
+class reclamation_queue
+{
+public:
+  reclamation_queue() = default;
+
+  reclamation_queue(reclamation_queue const&) = delete;
+  auto operator=(reclamation_queue const&) -> reclamation_queue& = delete;
+
+  ~reclamation_queue() { collect(); }
+
+  void push(reclamation_node& node) noexcept {
+    node.next = head_.load(std::memory_order_relaxed);
+    while (!head_.compare_exchange_weak(
+      node.next,
+      &node,
+      std::memory_order_release,
+      std::memory_order_relaxed)) {}
+  }
+
+  auto collect() noexcept -> std::size_t {
+    auto node = head_.exchange(nullptr, std::memory_order_acquire);
+
+    reclamation_node* reversed = nullptr;
+    while (node) {
+      auto const next = node->next;
+      node->next = reversed;
+      reversed = node;
+      node = next;
+    }
+
+    auto reclaimed = std::size_t(0);
+    while (reversed) {
+      auto const next = reversed->next;
+      reversed->reclaim();
+      reversed = next;
+      ++reclaimed;
+    }
+    return reclaimed;
+  }
+
+  // Collects until the queue stays empty, including objects pushed while
+  // reclaiming others, such as backends of deferred functions stored in
+  // reclaimed backends.
+  auto drain() noexcept -> std::size_t {
+    auto reclaimed = std::size_t(0);
+    while (auto const n = collect()) { reclaimed += n; }
+    return reclaimed;
+  }
+
+  auto empty() const noexcept -> bool {
+    return !head_.load(std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<reclamation_node*> head_{nullptr};
+};
+
+
+// Never destroyed: draining it during static destruction would free
+// backends through allocators and memory resources which may already be
+// gone. Backends still queued at exit are leaked. They stay reachable from
+// the queue, so leak checkers do not report them either; programs are
+// expected to drain the queue while the allocators are alive, typically
+// before returning from main.
+inline auto default_reclamation_queue() noexcept -> reclamation_queue& {
+  static auto* const queue = new reclamation_queue();
+  return *queue;
+}
+
+
+// Backends of handles with deferred destruction are nodes of the queue
+// themselves, so handing one over allocates nothing. They store the
+// allocator that frees them, like backends of thin handles do.
+template <class Traits>
+using maybe_deferred_interface = boost::mp11::mp_if<
+  is_deferred_destruction_enabled<Traits>,
+  boost::mp11::mp_list<reclamation_node>,
+  boost::mp11::mp_list<>>;
+
+
+template <class Derived, class Base>
+struct deferred_implementation : Base {
+  void reclaim() noexcept override {
+    auto& self = static_cast<Derived&>(*this);
+    auto alloc = self.stored_allocator();
+    self.delete_this(std::addressof(alloc));
+  }
+
+protected:
+  ~deferred_implementation() = default;
+};
+
+
+template <class Traits, class Derived, class Base>
+using maybe_deferred_implementation = boost::mp11::mp_eval_if_not<
+  is_deferred_destruction_enabled<Traits>,
+  Base,
+  deferred_implementation,
+  Derived,
+  Base>;
+
+
+// Instead of destroying a backend hands it over to the default reclamation
+// queue.
+template <class Allocator>
+struct deferred_backend_deleter : backend_deleter<Allocator> {
+  using backend_deleter<Allocator>::backend_deleter;
+
+  template <class Backend>
+  void operator()(Backend* ptr) noexcept {
+    default_reclamation_queue().push(*ptr);
+  }
+};
+
+
+} // namespace detail
+} // namespace xaos
+
+
+#endif // XAOS_DETAIL_RECLAMATION_HPP
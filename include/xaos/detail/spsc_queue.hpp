@@ -0,0 +1,173 @@
+#ifndef XAOS_DETAIL_SPSC_QUEUE_HPP
+#define XAOS_DETAIL_SPSC_QUEUE_HPP
+
+
+#include <xaos/detail/cache_line.hpp>
+
+#include <boost/core/empty_value.hpp>
+#include <boost/core/pointer_traits.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+
+namespace xaos {
+namespace detail {
+
+
+inline auto round_up_to_power_of_2(std::size_t n) noexcept -> std::size_t {
+  auto result = std::size_t(1);
+  while (result < n) { result <<= 1; }
+  return result;
+}
+
+
+// Bounded lock-free single-producer single-consumer ring buffer. The indices
+// of each side live on their own cache line together with a cached copy of
+// the other side's index, which is only refreshed when the cached value says
+// that the queue is full (or empty). Pushing and popping a batch of elements
+// publishes the whole batch with a single store.
+template <class T, class Allocator>
+class spsc_queue : boost::empty_value<Allocator>
+{
+  static_assert(std::is_nothrow_move_constructible<T>::value);
+
+private:
+  using alloc_traits = typename std::allocator_traits<
+    Allocator>::template rebind_traits<T>;
+  using allocator_type = typename alloc_traits::allocator_type;
+
+public:
+  spsc_queue(std::size_t capacity, Allocator const& alloc)
+    : boost::empty_value<Allocator>(boost::empty_init_t(), alloc)
+    , mask_(round_up_to_power_of_2(std::max(capacity, std::size_t(1))) - 1)
+  {
+    auto slot_alloc = allocator_type(get_allocator());
+    slots_ = boost::to_address(alloc_traits::allocate(slot_alloc, mask_ + 1));
+  }
+
+  spsc_queue(spsc_queue const&) = delete;
+  auto operator=(spsc_queue const&) -> spsc_queue& = delete;
+
+  ~spsc_queue() {
+    auto slot_alloc = allocator_type(get_allocator());
+    auto const tail = tail_.load(std::memory_order_acquire);
+    for (auto head = head_.load(std::memory_order_relaxed); head != tail;
+         ++head) {
+      alloc_traits::destroy(slot_alloc, slots_ + (head & mask_));
+    }
+    alloc_traits::deallocate(
+      slot_alloc,
+      std::pointer_traits<typename alloc_traits::pointer>::pointer_to(
+        *slots_),
+      mask_ + 1);
+  }
+
+  // producer side
+
+  template <class U>
+  auto try_push(U&& value) -> bool {
+    auto const tail = tail_.load(std::memory_order_relaxed);
+    if (free_slots(tail, 1) == 0) { return false; }
+
+    auto slot_alloc = allocator_type(get_allocator());
+    alloc_traits::construct(
+      slot_alloc, slots_ + (tail & mask_), static_cast<U&&>(value));
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Moves up to n elements from the sequence starting at first into the
+  // queue. Returns the number of moved elements.
+  template <class InputIt>
+  auto push_n(InputIt first, std::size_t n) -> std::size_t {
+    auto const tail = tail_.load(std::memory_order_relaxed);
+    n = std::min(n, free_slots(tail, n));
+
+    auto slot_alloc = allocator_type(get_allocator());
+    auto pushed = std::size_t(0);
+    try {
+      for (; pushed != n; ++pushed, ++first) {
+        alloc_traits::construct(
+          slot_alloc, slots_ + ((tail + pushed) & mask_), std::move(*first));
+      }
+    } catch (...) {
+      tail_.store(tail + pushed, std::memory_order_release);
+      throw;
+    }
+    tail_.store(tail + n, std::memory_order_release);
+    return n;
+  }
+
+  // consumer side
+
+  // Moves up to max elements out of the queue into out. Returns the number
+  // of moved elements.
+  template <class OutputIt>
+  auto pop_n(OutputIt out, std::size_t max) -> std::size_t {
+    auto const head = head_.load(std::memory_order_relaxed);
+    auto available = cached_tail_ - head;
+    if (available < max) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      available = cached_tail_ - head;
+    }
+    auto const n = std::min(max, available);
+
+    auto slot_alloc = allocator_type(get_allocator());
+    for (std::size_t i = 0; i != n; ++i, ++out) {
+      auto const slot = slots_ + ((head + i) & mask_);
+      *out = std::move(*slot);
+      alloc_traits::destroy(slot_alloc, slot);
+    }
+    head_.store(head + n, std::memory_order_release);
+    return n;
+  }
+
+  // either side
+
+  // The number of elements in the queue. The result is approximate when the
+  // other side is active concurrently.
+  auto size() const noexcept -> std::size_t {
+    auto const head = head_.load(std::memory_order_acquire);
+    auto const tail = tail_.load(std::memory_order_acquire);
+    return tail - head;
+  }
+
+  auto empty() const noexcept -> bool { return size() == 0; }
+
+  auto capacity() const noexcept -> std::size_t { return mask_ + 1; }
+
+  auto get_allocator() const -> Allocator {
+    return boost::empty_value<Allocator>::get();
+  }
+
+private:
+  auto free_slots(std::size_t tail, std::size_t wanted) -> std::size_t {
+    auto free = capacity() - (tail - cached_head_);
+    if (free < wanted) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      free = capacity() - (tail - cached_head_);
+    }
+    return free;
+  }
+
+  // read-only after construction
+  T* slots_;
+  std::size_t const mask_;
+
+  alignas(cache_line_size) std::atomic<std::size_t> head_{0};
+  std::size_t cached_tail_ = 0;
+
+  alignas(cache_line_size) std::atomic<std::size_t> tail_{0};
+  std::size_t cached_head_ = 0;
+};
+
+
+} // namespace detail
+} // namespace xaos
+
+
+#endif // XAOS_DETAIL_SPSC_QUEUE_HPP
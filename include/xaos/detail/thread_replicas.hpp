@@ -0,0 +1,131 @@
+#ifndef XAOS_DETAIL_THREAD_REPLICAS_HPP
+#define XAOS_DETAIL_THREAD_REPLICAS_HPP
+
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+
+namespace xaos {
+namespace detail {
+
+
+// Identifies owners of per-thread replicas. Identifiers are never reused, so
+// entries left behind by destroyed owners are never mistaken for live ones.
+inline auto next_replica_owner() noexcept -> std::uint64_t {
+  static std::atomic<std::uint64_t> next{1};
+  return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+struct replica_entry {
+  std::uint64_t owner = 0;
+  void* replica = nullptr;
+};
+
+// The replica used last by the calling thread, checked before the map.
+inline auto last_replica() noexcept -> replica_entry& {
+  thread_local replica_entry last;
+  return last;
+}
+
+
+// The replicas of one thread by owner. The mutex is only contended while an
+// owner erases its entries.
+class replica_map
+{
+public:
+  auto find(std::uint64_t owner) -> void* {
+    auto lock = std::lock_guard<std::mutex>(mutex_);
+    auto const found = replicas_.find(owner);
+    return found != replicas_.end() ? found->second : nullptr;
+  }
+
+  void insert(std::uint64_t owner, void* replica) {
+    auto lock = std::lock_guard<std::mutex>(mutex_);
+    replicas_.emplace(owner, replica);
+  }
+
+  void erase(std::uint64_t owner) {
+    auto lock = std::lock_guard<std::mutex>(mutex_);
+    replicas_.erase(owner);
+  }
+
+  auto size() -> std::size_t {
+    auto lock = std::lock_guard<std::mutex>(mutex_);
+    return replicas_.size();
+  }
+
+private:
+  std::mutex mutex_;
+  std::unordered_map<std::uint64_t, void*> replicas_;
+};
+
+
+// The maps of all running threads. It is never destroyed, as threads may
+// exit after static objects are.
+struct replica_registry {
+  std::mutex mutex;
+  std::unordered_set<replica_map*> maps;
+};
+
+inline auto global_replica_registry() -> replica_registry& {
+  static auto* const registry = new replica_registry();
+  return *registry;
+}
+
+
+class registered_replica_map : public replica_map
+{
+public:
+  registered_replica_map() {
+    auto& registry = global_replica_registry();
+    auto lock = std::lock_guard<std::mutex>(registry.mutex);
+    registry.maps.insert(this);
+  }
+
+  registered_replica_map(registered_replica_map const&) = delete;
+  auto operator=(registered_replica_map const&)
+    -> registered_replica_map& = delete;
+
+  ~registered_replica_map() {
+    auto& registry = global_replica_registry();
+    auto lock = std::lock_guard<std::mutex>(registry.mutex);
+    registry.maps.erase(this);
+  }
+};
+
+inline auto thread_replicas() -> replica_map& {
+  thread_local registered_replica_map replicas;
+  return replicas;
+}
+
+
+// The identifier of an owner of replicas. Its entries are erased from the
+// maps of all threads when it is destroyed, so that the maps of long-lived
+// threads do not grow with every owner they have called.
+class replica_owner
+{
+public:
+  replica_owner() = default;
+  replica_owner(replica_owner const&) = delete;
+  auto operator=(replica_owner const&) -> replica_owner& = delete;
+
+  ~replica_owner() {
+    auto& registry = global_replica_registry();
+    auto lock = std::lock_guard<std::mutex>(registry.mutex);
+    for (auto const map : registry.maps) { map->erase(id); }
+  }
+
+  std::uint64_t const id = next_replica_owner();
+};
+
+
+} // namespace detail
+} // namespace xaos
+
+
+#endif // XAOS_DETAIL_THREAD_REPLICAS_HPP
@@ -0,0 +1,81 @@
+#ifndef XAOS_DETAIL_TIMER_WHEEL_HPP
+#define XAOS_DETAIL_TIMER_WHEEL_HPP
+
+
+#include <xaos/detail/function_alloc.hpp>
+
+#include <boost/assert.hpp>
+
+#include <cstdint>
+#include <optional>
+
+
+namespace xaos {
+namespace detail {
+
+
+struct list_hook {
+  list_hook() noexcept : prev(this), next(this) {}
+
+  list_hook(list_hook const&) = delete;
+  auto operator=(list_hook const&) -> list_hook& = delete;
+
+  auto empty() const noexcept -> bool { return next == this; }
+
+  void link_before(list_hook& pos) noexcept {
+    next = &pos;
+    prev = pos.prev;
+    pos.prev->next = this;
+    pos.prev = this;
+  }
+
+  void unlink() noexcept {
+    prev->next = next;
+    next->prev = prev;
+    prev = next = this;
+  }
+
+  // moves all elements of other to the end of this list
+  void splice(list_hook& other) noexcept {
+    if (other.empty()) { return; }
+
+    other.next->prev = prev;
+    prev->next = other.next;
+    other.prev->next = this;
+    prev = other.prev;
+    other.prev = other.next = &other;
+  }
+
+  list_hook* prev;
+  list_hook* next;
+};
+
+
+template <class Callback, class Allocator>
+struct timer_node
+  : list_hook
+  , pointer_storage_helper<timer_node<Callback, Allocator>, Allocator, 0> {
+  using pointer_holder_t
+    = pointer_storage_helper<timer_node, Allocator, 0>;
+
+  timer_node(typename pointer_holder_t::pointer ptr)
+    : pointer_holder_t(std::move(ptr)) {}
+
+  std::uint64_t deadline = 0;
+  std::uint64_t generation = 0;
+  unsigned level = 0;
+  timer_node* next_free = nullptr;
+  std::optional<Callback> callback;
+};
+
+
+constexpr unsigned timer_wheel_slot_bits = 6;
+constexpr unsigned timer_wheel_slots = 1u << timer_wheel_slot_bits;
+constexpr unsigned timer_wheel_levels = 6;
+
+
+} // namespace detail
+} // namespace xaos
+
+
+#endif // XAOS_DETAIL_TIMER_WHEEL_HPP
@@ -0,0 +1,218 @@
+#ifndef XAOS_DISPATCH_TABLE_HPP
+#define XAOS_DISPATCH_TABLE_HPP
+
+
+#include <xaos/arena.hpp>
+#include <xaos/compact.hpp>
+#include <xaos/detail/perfect_hash.hpp>
+#include <xaos/function.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace xaos {
+
+
+// Immutable map from keys to handlers. The handlers are kept in a dense
+// array, and their backends are compacted into an arena owned by the table in
+// the same order. Integer keys which lie close together index the array
+// directly, other keys are looked up with a perfect hash function built on
+// construction. If Hash gives distinct keys equal values, no perfect hash
+// function exists, and keys are found by binary search over their hash
+// values instead.
+template <class Key, class Signature, class Hash = std::hash<Key>>
+class dispatch_table
+{
+public:
+  using key_type = Key;
+  using handler_type = function<Signature, arena_allocator<void>>;
+  using entry_type = std::pair<Key, handler_type>;
+
+  // Throws std::invalid_argument if keys repeat.
+  dispatch_table(std::initializer_list<entry_type> entries)
+    : dispatch_table(std::vector<entry_type>(entries)) {}
+
+  explicit dispatch_table(std::vector<entry_type> entries)
+    : arena_(std::make_unique<arena>()) {
+    if constexpr (is_direct_key::value) {
+      if (build_direct(entries)) {
+        finish();
+        return;
+      }
+    }
+    build_hashed(entries);
+    finish();
+  }
+
+  auto find(Key const& key) noexcept -> handler_type* {
+    auto const index = index_of(key);
+    return index < handlers_.size() ? &handlers_[index] : nullptr;
+  }
+
+  auto find(Key const& key) const noexcept -> handler_type const* {
+    auto const index = index_of(key);
+    return index < handlers_.size() ? &handlers_[index] : nullptr;
+  }
+
+  auto contains(Key const& key) const noexcept -> bool {
+    return find(key) != nullptr;
+  }
+
+  auto size() const noexcept -> std::size_t { return handlers_.size(); }
+
+  auto empty() const noexcept -> bool { return handlers_.empty(); }
+
+private:
+  using is_direct_key = std::bool_constant<
+    std::is_integral<Key>::value && !std::is_same<Key, bool>::value>;
+  using unsigned_key = std::make_unsigned_t<
+    std::conditional_t<is_direct_key::value, Key, int>>;
+
+  // direct indexing is used as long as no more than this share of the array
+  // would be unused
+  static constexpr std::size_t max_direct_spread = 4;
+
+  auto build_direct(std::vector<entry_type>& entries) -> bool {
+    if (entries.empty()) { return false; }
+
+    std::sort(entries.begin(), entries.end(), [](auto& l, auto& r) {
+      return l.first < r.first;
+    });
+    auto const range = static_cast<std::size_t>(static_cast<unsigned_key>(
+      static_cast<unsigned_key>(entries.back().first)
+      - static_cast<unsigned_key>(entries.front().first)));
+    if (range >= entries.size() * max_direct_spread + 64) { return false; }
+
+    min_key_ = static_cast<unsigned_key>(entries.front().first);
+    positions_.assign(range + 1, no_position);
+    handlers_.reserve(entries.size());
+    for (auto& entry : entries) {
+      auto& position = positions_[offset(entry.first)];
+      if (position != no_position) {
+        throw std::invalid_argument("xaos: duplicate dispatch_table key");
+      }
+      position = static_cast<std::uint32_t>(handlers_.size());
+      handlers_.push_back(std::move(entry.second));
+    }
+    direct_ = true;
+    return true;
+  }
+
+  void build_hashed(std::vector<entry_type>& entries) {
+    auto hashes = std::vector<std::uint64_t>();
+    hashes.reserve(entries.size());
+    for (auto const& entry : entries) {
+      hashes.push_back(static_cast<std::uint64_t>(Hash()(entry.first)));
+    }
+
+    auto order = std::vector<std::size_t>(entries.size());
+    std::iota(order.begin(), order.end(), std::size_t(0));
+    std::sort(order.begin(), order.end(), [&](auto l, auto r) {
+      return hashes[l] < hashes[r];
+    });
+
+    // only keys with equal hash values can be equal
+    auto collides = false;
+    for (std::size_t k = 1; k < order.size(); ++k) {
+      auto const hash = hashes[order[k]];
+      for (auto j = k; j-- > 0 && hashes[order[j]] == hash;) {
+        if (entries[order[j]].first == entries[order[k]].first) {
+          throw std::invalid_argument("xaos: duplicate dispatch_table key");
+        }
+        collides = true;
+      }
+    }
+
+    if (collides || !build_perfect_hash(hashes, order)) {
+      sorted_hashes_.reserve(entries.size());
+      for (auto const i : order) { sorted_hashes_.push_back(hashes[i]); }
+    }
+
+    keys_.reserve(entries.size());
+    handlers_.reserve(entries.size());
+    for (auto const i : order) {
+      keys_.push_back(std::move(entries[i].first));
+      handlers_.push_back(std::move(entries[i].second));
+    }
+  }
+
+  // Reorders the entries by slot. Fails only if no displacement separates
+  // the values of a bucket, which is practically impossible.
+  auto build_perfect_hash(
+    std::vector<std::uint64_t> const& hashes, std::vector<std::size_t>& order)
+    -> bool {
+    std::vector<std::size_t> slots;
+    try {
+      slots = hash_.build(hashes);
+    } catch (std::invalid_argument const&) {
+      return false;
+    }
+
+    for (std::size_t i = 0; i != slots.size(); ++i) { order[slots[i]] = i; }
+    return true;
+  }
+
+  void finish() { compact(handlers_, arena_allocator<void>(*arena_)); }
+
+  auto offset(Key const& key) const noexcept -> std::size_t {
+    return static_cast<std::size_t>(static_cast<unsigned_key>(
+      static_cast<unsigned_key>(key) - min_key_));
+  }
+
+  auto index_of(Key const& key) const noexcept -> std::size_t {
+    if constexpr (is_direct_key::value) {
+      if (direct_) {
+        auto const off = offset(key);
+        return off < positions_.size() ? positions_[off] : no_position;
+      }
+    }
+    if (handlers_.empty()) { return no_position; }
+    auto const hash = static_cast<std::uint64_t>(Hash()(key));
+    if (!sorted_hashes_.empty()) {
+      auto i = static_cast<std::size_t>(
+        std::lower_bound(sorted_hashes_.begin(), sorted_hashes_.end(), hash)
+        - sorted_hashes_.begin());
+      for (; i != sorted_hashes_.size() && sorted_hashes_[i] == hash; ++i) {
+        if (keys_[i] == key) { return i; }
+      }
+      return no_position;
+    }
+
+    auto const slot = hash_(hash);
+    return keys_[slot] == key ? slot : no_position;
+  }
+
+  static constexpr std::uint32_t no_position = ~std::uint32_t(0);
+
+  // must outlive the handlers
+  std::unique_ptr<arena> arena_;
+  std::vector<handler_type> handlers_;
+
+  // direct indexing
+  bool direct_ = false;
+  unsigned_key min_key_ = 0;
+  std::vector<std::uint32_t> positions_;
+
+  // perfect hashing
+  detail::perfect_hash hash_;
+  std::vector<Key> keys_;
+
+  // binary search, in the order of keys_; empty if the perfect hash is used
+  std::vector<std::uint64_t> sorted_hashes_;
+};
+
+
+} // namespace xaos
+
+
+#endif // XAOS_DISPATCH_TABLE_HPP
@@ -2,8 +2,10 @@
 #define XAOS_FUNCTION_HPP
 
 
+#include <xaos/detail/cache_line.hpp>
 #include <xaos/detail/function.hpp>
 
+#include <cstddef>
 #include <memory>
 
 
@@ -24,6 +26,41 @@ struct rvalue_function_traits {
   static constexpr bool rvalue_ref_call = true;
 };
 
+// The rvalue call destroys the callable and frees the backend, leaving the
+// function empty.
+struct consuming_rfunction_traits {
+  static constexpr bool rvalue_ref_call = true;
+  static constexpr bool consume_on_call = true;
+};
+
+// Thin handles are a single pointer, the allocator is kept in the backend.
+struct thin_function_traits {
+  static constexpr bool is_copyable = true;
+  static constexpr bool lvalue_ref_call = true;
+  static constexpr bool thin_handle = true;
+};
+
+struct thin_rfunction_traits {
+  static constexpr bool rvalue_ref_call = true;
+  static constexpr bool thin_handle = true;
+};
+
+// Backends occupy whole cache lines, so that functions called from different
+// threads do not slow each other down by false sharing.
+struct isolated_function_traits {
+  static constexpr bool is_copyable = true;
+  static constexpr bool lvalue_ref_call = true;
+  static constexpr std::size_t backend_alignment = detail::cache_line_size;
+};
+
+// Backends have a slot running a loop over arrays of arguments, so that
+// invoke_bulk pays a single indirect call for the whole loop.
+struct bulk_function_traits {
+  static constexpr bool is_copyable = true;
+  static constexpr bool lvalue_ref_call = true;
+  static constexpr bool bulk_call = true;
+};
+
 
 template <
   class Signature,
@@ -48,6 +85,26 @@ using const_function
 template <class Signature, class Allocator = std::allocator<void>>
 using rfunction = basic_function<Signature, rvalue_function_traits, Allocator>;
 
+template <class Signature, class Allocator = std::allocator<void>>
+using consuming_rfunction
+  = basic_function<Signature, consuming_rfunction_traits, Allocator>;
+
+template <class Signature, class Allocator = std::allocator<void>>
+using thin_function
+  = basic_function<Signature, thin_function_traits, Allocator>;
+
+template <class Signature, class Allocator = std::allocator<void>>
+using thin_rfunction
+  = basic_function<Signature, thin_rfunction_traits, Allocator>;
+
+template <class Signature, class Allocator = std::allocator<void>>
+using isolated_function
+  = basic_function<Signature, isolated_function_traits, Allocator>;
+
+template <class Signature, class Allocator = std::allocator<void>>
+using bulk_function
+  = basic_function<Signature, bulk_function_traits, Allocator>;
+
 
 } // namespace xaos
 
@@ -0,0 +1,205 @@
+#ifndef XAOS_FUTURE_HPP
+#define XAOS_FUTURE_HPP
+
+
+#include <xaos/detail/future.hpp>
+
+#include <boost/assert.hpp>
+#include <boost/core/empty_value.hpp>
+
+#include <exception>
+#include <future>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+
+namespace xaos {
+
+
+template <class T, class Allocator = std::allocator<void>>
+class promise;
+
+
+// The receiving end of a one-shot asynchronous result. Continuations
+// attached with then are stored in the same allocation as the state of the
+// future they return, and run inline on the thread which provides the
+// result, or on the attaching thread if the result is already there.
+template <class T, class Allocator = std::allocator<void>>
+class future : boost::empty_value<Allocator>
+{
+  using alloc_base = boost::empty_value<Allocator>;
+
+public:
+  using value_type = T;
+  using allocator_type = Allocator;
+
+  future() = default;
+
+  future(future&& other) noexcept
+    : alloc_base(boost::empty_init_t(), other.get_allocator())
+    , state_(std::exchange(other.state_, nullptr)) {}
+
+  auto operator=(future&& other) noexcept -> future& {
+    if (this != &other) {
+      reset();
+      alloc_base::get() = other.get_allocator();
+      state_ = std::exchange(other.state_, nullptr);
+    }
+    return *this;
+  }
+
+  ~future() { reset(); }
+
+  auto valid() const noexcept -> bool { return state_ != nullptr; }
+
+  auto is_ready() const noexcept -> bool {
+    BOOST_ASSERT(valid());
+    return state_->is_ready();
+  }
+
+  void wait() const noexcept {
+    BOOST_ASSERT(valid());
+    state_->wait();
+  }
+
+  // Waits for the result and returns it, or throws the stored exception.
+  // The future is invalid afterwards.
+  auto get() -> T {
+    BOOST_ASSERT(valid());
+    state_->wait();
+    auto const state = std::exchange(state_, nullptr);
+    auto guard = release_guard{state};
+    return state->take();
+  }
+
+  // Attaches a continuation which receives the result and returns a future
+  // for the result of the continuation. If this future holds an exception,
+  // the continuation is skipped and the exception is passed on. The future is
+  // invalid afterwards.
+  template <class F>
+  auto then(F&& f) && {
+    BOOST_ASSERT(valid());
+    using node_type = detail::
+      continuation_state<T, std::decay_t<F>, allocator_type>;
+    using result_type = typename node_type::result_type;
+    using node_allocator = typename std::allocator_traits<
+      allocator_type>::template rebind_alloc<node_type>;
+
+    auto alloc = node_allocator(get_allocator());
+    auto const node
+      = detail::new_backend(alloc, static_cast<F&&>(f), get_allocator());
+    // the node takes over the reference held by this future
+    std::exchange(state_, nullptr)->attach(*node);
+    return future<result_type, allocator_type>(node, get_allocator());
+  }
+
+  auto get_allocator() const noexcept -> allocator_type {
+    return alloc_base::get();
+  }
+
+private:
+  template <class, class>
+  friend class future;
+
+  template <class, class>
+  friend class promise;
+
+  struct release_guard {
+    ~release_guard() { state->release(); }
+    detail::future_state<T>* state;
+  };
+
+  future(detail::future_state<T>* state, allocator_type const& alloc) noexcept
+    : alloc_base(boost::empty_init_t(), alloc), state_(state) {}
+
+  void reset() noexcept {
+    if (state_) { std::exchange(state_, nullptr)->release(); }
+  }
+
+  detail::future_state<T>* state_ = nullptr;
+};
+
+
+// The providing end of a one-shot asynchronous result. The state shared with
+// the future is allocated once on construction. Destroying a promise without
+// providing a result stores std::future_error with
+// std::future_errc::broken_promise.
+template <class T, class Allocator>
+class promise : boost::empty_value<Allocator>
+{
+  using alloc_base = boost::empty_value<Allocator>;
+  using state_type = detail::promise_state<T, Allocator>;
+  using state_allocator = typename std::allocator_traits<
+    Allocator>::template rebind_alloc<state_type>;
+
+public:
+  using value_type = T;
+  using allocator_type = Allocator;
+
+  explicit promise(allocator_type const& alloc = allocator_type())
+    : alloc_base(boost::empty_init_t(), alloc) {
+    auto state_alloc = state_allocator(alloc);
+    state_ = detail::new_backend(state_alloc, alloc);
+  }
+
+  promise(promise&& other) noexcept
+    : alloc_base(boost::empty_init_t(), other.get_allocator())
+    , state_(std::exchange(other.state_, nullptr))
+    , retrieved_(other.retrieved_) {}
+
+  auto operator=(promise&& other) noexcept -> promise& {
+    if (this != &other) {
+      abandon();
+      alloc_base::get() = other.get_allocator();
+      state_ = std::exchange(other.state_, nullptr);
+      retrieved_ = other.retrieved_;
+    }
+    return *this;
+  }
+
+  ~promise() { abandon(); }
+
+  // May be called once.
+  auto get_future() -> future<T, allocator_type> {
+    BOOST_ASSERT(state_ && !retrieved_);
+    retrieved_ = true;
+    state_->add_ref();
+    return future<T, allocator_type>(state_, get_allocator());
+  }
+
+  // Stores the result, running an attached continuation inline. May be
+  // called once.
+  template <class... Args>
+  void set_value(Args&&... args) {
+    BOOST_ASSERT(state_);
+    state_->set_value(static_cast<Args&&>(args)...);
+    std::exchange(state_, nullptr)->release();
+  }
+
+  void set_exception(std::exception_ptr e) noexcept {
+    BOOST_ASSERT(state_);
+    state_->set_exception(std::move(e));
+    std::exchange(state_, nullptr)->release();
+  }
+
+  auto get_allocator() const noexcept -> allocator_type {
+    return alloc_base::get();
+  }
+
+private:
+  void abandon() noexcept {
+    if (!state_) { return; }
+    set_exception(std::make_exception_ptr(
+      std::future_error(std::future_errc::broken_promise)));
+  }
+
+  state_type* state_ = nullptr;
+  bool retrieved_ = false;
+};
+
+
+} // namespace xaos
+
+
+#endif // XAOS_FUTURE_HPP
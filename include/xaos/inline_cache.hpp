@@ -0,0 +1,84 @@
+#ifndef XAOS_INLINE_CACHE_HPP
+#define XAOS_INLINE_CACHE_HPP
+
+
+#include <xaos/detail/inline_cache.hpp>
+
+#include <boost/assert.hpp>
+#include <boost/mp11/list.hpp>
+
+#include <cstddef>
+#include <typeinfo>
+
+
+namespace xaos {
+
+
+// Calls a function like its parentheses operator does. If the function holds
+// a callable of one of the types Callables, the callable is called directly,
+// which lets the compiler inline it. Otherwise the call goes through the
+// backend's virtual function. The function must not be empty.
+template <class... Callables, class Function, class... Args>
+auto invoke_as(Function& f, Args&&... args)
+  -> detail::guarded_call_result<Function, Args&&...> {
+  BOOST_ASSERT(f);
+  auto hit = false;
+  auto& type = typeid(*detail::function_access::storage(f));
+  return detail::guarded_call(
+    f,
+    type,
+    hit,
+    boost::mp11::mp_list<Callables...>(),
+    static_cast<Args&&>(args)...);
+}
+
+
+// A call site which expects to see callables of the types Callables, and
+// counts how often it does. The counters are not synchronized, a cache
+// shared between threads needs external synchronization.
+template <class... Callables>
+class inline_cache
+{
+public:
+  template <class Function, class... Args>
+  auto operator()(Function& f, Args&&... args)
+    -> detail::guarded_call_result<Function, Args&&...> {
+    BOOST_ASSERT(f);
+    auto hit = false;
+    auto& type = typeid(*detail::function_access::storage(f));
+    // counted on the way out, so that calls which throw are counted too
+    struct counter {
+      ~counter() { ++(hit ? cache.hits_ : cache.misses_); }
+      inline_cache& cache;
+      bool& hit;
+    } count{*this, hit};
+    return detail::guarded_call(
+      f,
+      type,
+      hit,
+      boost::mp11::mp_list<Callables...>(),
+      static_cast<Args&&>(args)...);
+  }
+
+  auto hits() const noexcept -> std::size_t { return hits_; }
+
+  auto misses() const noexcept -> std::size_t { return misses_; }
+
+  // The share of calls which were made directly, 0 if there were none.
+  auto hit_rate() const noexcept -> double {
+    auto const calls = hits_ + misses_;
+    return calls ? double(hits_) / double(calls) : 0.0;
+  }
+
+  void reset() noexcept { hits_ = misses_ = 0; }
+
+private:
+  std::size_t hits_ = 0;
+  std::size_t misses_ = 0;
+};
+
+
+} // namespace xaos
+
+
+#endif // XAOS_INLINE_CACHE_HPP
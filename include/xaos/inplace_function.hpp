@@ -0,0 +1,39 @@
+#ifndef XAOS_INPLACE_FUNCTION_HPP
+#define XAOS_INPLACE_FUNCTION_HPP
+
+
+#include <xaos/detail/inplace_function.hpp>
+#include <xaos/function.hpp>
+
+#include <boost/mp11/integral.hpp>
+
+#include <cstddef>
+
+
+namespace xaos {
+
+
+// A function which never allocates. The callable is stored in a buffer of
+// Capacity bytes inside the function object, callables which do not fit or
+// need more than fundamental alignment are rejected at compile time.
+// Callables must be nothrow move constructible. Copying and moving a
+// trivially copyable callable copies the buffer.
+//
+// Traits select the call operators and copyability as for basic_function.
+template <
+  class Signature,
+  std::size_t Capacity = 4 * sizeof(void*),
+  class Traits = function_traits>
+using inplace_function = boost::mp11::mp_apply_q<
+  boost::mp11::mp_bind_front<
+    detail::basic_inplace_function,
+    Signature,
+    Traits,
+    boost::mp11::mp_size_t<Capacity>>,
+  detail::enabled_overloads<Signature, Traits>>;
+
+
+} // namespace xaos
+
+
+#endif // XAOS_INPLACE_FUNCTION_HPP
@@ -0,0 +1,110 @@
+#ifndef XAOS_LAZY_HPP
+#define XAOS_LAZY_HPP
+
+
+#include <xaos/function.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+
+namespace xaos {
+
+
+// A value computed on first access by a producing function. Once the value
+// is there, accessing it is a single acquire load. Threads which access it
+// while the first one computes it block until it is done. The producer is
+// destroyed, and its backend freed, as soon as the value is computed.
+//
+// If the producer throws, the exception propagates to the thread that called
+// it and the next access calls the producer again, like std::call_once does.
+template <class T, class Allocator = std::allocator<void>>
+class lazy
+{
+public:
+  using value_type = T;
+  using function_type = rfunction<T(), Allocator>;
+  using allocator_type = typename function_type::allocator_type;
+
+  explicit lazy(function_type producer)
+    : producer_(std::move(producer))
+    , allocator_(producer_.get_allocator()) {}
+
+  lazy(lazy const&) = delete;
+  auto operator=(lazy const&) -> lazy& = delete;
+
+  auto get() -> T& {
+    if (state_.load(std::memory_order_acquire) != ready) { evaluate(); }
+    return *value_;
+  }
+
+  auto get() const -> T const& {
+    if (state_.load(std::memory_order_acquire) != ready) { evaluate(); }
+    return *value_;
+  }
+
+  auto operator*() -> T& { return get(); }
+  auto operator*() const -> T const& { return get(); }
+
+  auto operator->() -> T* { return std::addressof(get()); }
+  auto operator->() const -> T const* { return std::addressof(get()); }
+
+  auto is_ready() const noexcept -> bool {
+    return state_.load(std::memory_order_acquire) == ready;
+  }
+
+  auto get_allocator() const -> allocator_type { return allocator_; }
+
+private:
+  enum state : unsigned char { pending, running, ready };
+
+  void evaluate() const {
+    auto lock = std::unique_lock<std::mutex>(mutex_);
+    cv_.wait(lock, [&] {
+      return state_.load(std::memory_order_relaxed) != running;
+    });
+    if (state_.load(std::memory_order_relaxed) == ready) { return; }
+
+    state_.store(running, std::memory_order_relaxed);
+    lock.unlock();
+
+    try {
+      value_.emplace(std::move(producer_)());
+    } catch (...) {
+      lock.lock();
+      state_.store(pending, std::memory_order_relaxed);
+      lock.unlock();
+      cv_.notify_all();
+      throw;
+    }
+
+    // frees the backend before anyone waits for the value
+    auto const consumed = std::move(producer_);
+    static_cast<void>(consumed);
+
+    lock.lock();
+    state_.store(ready, std::memory_order_release);
+    lock.unlock();
+    cv_.notify_all();
+  }
+
+  // evaluation is not an observable modification, so const access computes
+  // the value as well
+  mutable std::atomic<state> state_{pending};
+  mutable std::optional<T> value_;
+  mutable function_type producer_;
+  allocator_type allocator_;
+
+  mutable std::mutex mutex_;
+  mutable std::condition_variable cv_;
+};
+
+
+} // namespace xaos
+
+
+#endif // XAOS_LAZY_HPP
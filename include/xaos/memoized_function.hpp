@@ -0,0 +1,43 @@
+#ifndef XAOS_MEMOIZED_FUNCTION_HPP
+#define XAOS_MEMOIZED_FUNCTION_HPP
+
+
+#include <xaos/detail/memoized_function.hpp>
+
+#include <memory>
+
+
+namespace xaos {
+
+
+struct memoize_traits {};
+
+struct concurrent_memoize_traits {
+  static constexpr bool is_concurrent = true;
+  static constexpr std::size_t shard_count = 16;
+};
+
+
+template <
+  class Signature,
+  class Traits,
+  class Allocator = std::allocator<void>>
+using basic_memoized_function = detail::basic_memoized_function<
+  Signature,
+  Traits,
+  typename std::allocator_traits<Allocator>::template rebind_alloc<void>>;
+
+
+template <class Signature, class Allocator = std::allocator<void>>
+using memoized_function
+  = basic_memoized_function<Signature, memoize_traits, Allocator>;
+
+template <class Signature, class Allocator = std::allocator<void>>
+using concurrent_memoized_function
+  = basic_memoized_function<Signature, concurrent_memoize_traits, Allocator>;
+
+
+} // namespace xaos
+
+
+#endif // XAOS_MEMOIZED_FUNCTION_HPP
@@ -0,0 +1,202 @@
+#ifndef XAOS_PIPELINE_HPP
+#define XAOS_PIPELINE_HPP
+
+
+#include <xaos/detail/spsc_queue.hpp>
+#include <xaos/function.hpp>
+#include <xaos/span.hpp>
+
+#include <boost/assert.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+namespace xaos {
+
+
+// A fixed sequence of stages, each running on its own thread and passing
+// elements on to the next one through a bounded single-producer
+// single-consumer queue. Elements are moved between stages in batches and
+// leave the pipeline after the last stage. A stage is invoked once per batch
+// and may modify the elements in place. A stage that throws terminates the
+// program.
+//
+// Elements are pushed by a single thread. Stages are added before the
+// pipeline is started and run until it is closed.
+template <class T, class Allocator = std::allocator<void>>
+class pipeline
+{
+public:
+  using value_type = T;
+  using allocator_type =
+    typename std::allocator_traits<Allocator>::template rebind_alloc<void>;
+  using stage_type = function<void(span<T>), allocator_type>;
+
+private:
+  struct stage {
+    stage(
+      stage_type fn, std::size_t queue_capacity, allocator_type const& alloc)
+      : fn(std::move(fn)), input(queue_capacity, alloc) {}
+
+    stage_type fn;
+    detail::spsc_queue<T, allocator_type> input;
+    std::thread thread;
+
+    alignas(detail::cache_line_size) std::atomic<std::uint64_t> processed{0};
+    std::atomic<bool> finished{false};
+  };
+
+  using stage_allocator =
+    typename std::allocator_traits<Allocator>::template rebind_alloc<stage>;
+  using batch_allocator =
+    typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+
+public:
+  explicit pipeline(
+    std::size_t queue_capacity = 1024,
+    std::size_t batch_size = 64,
+    allocator_type alloc = allocator_type())
+    : alloc_(alloc)
+    , queue_capacity_(queue_capacity)
+    , batch_size_(batch_size)
+    , stages_(stage_allocator(alloc)) {
+    BOOST_ASSERT(batch_size > 0);
+  }
+
+  pipeline(pipeline const&) = delete;
+  auto operator=(pipeline const&) -> pipeline& = delete;
+
+  // Closes the pipeline.
+  ~pipeline() { close(); }
+
+  // Appends a stage, which is either invocable with span<T> or with T&.
+  // In the latter case it is called for every element of a batch.
+  template <class Callable>
+  auto add_stage(Callable&& callable) -> pipeline& {
+    BOOST_ASSERT(!started_);
+    using callable_type = std::decay_t<Callable>;
+    if constexpr (std::is_invocable<callable_type&, span<T>>::value) {
+      stages_.emplace_back(
+        stage_type(static_cast<Callable&&>(callable), alloc_),
+        queue_capacity_,
+        alloc_);
+    } else {
+      auto per_element = [c = static_cast<Callable&&>(callable)](
+                           span<T> batch) mutable {
+        for (auto& element : batch) { c(element); }
+      };
+      stages_.emplace_back(
+        stage_type(std::move(per_element), alloc_), queue_capacity_, alloc_);
+    }
+    return *this;
+  }
+
+  // Launches a thread for every stage.
+  void start() {
+    BOOST_ASSERT(!started_ && !stages_.empty());
+    started_ = true;
+    for (std::size_t i = 0; i != stages_.size(); ++i) {
+      stages_[i].thread = std::thread([this, i] { run_stage(i); });
+    }
+  }
+
+  // Passes the element to the first stage, waiting while its queue is full.
+  void push(T value) {
+    BOOST_ASSERT(started_ && !closed_);
+    while (!stages_.front().input.try_push(std::move(value))) {
+      std::this_thread::yield();
+    }
+  }
+
+  auto try_push(T& value) -> bool {
+    BOOST_ASSERT(started_ && !closed_);
+    return stages_.front().input.try_push(std::move(value));
+  }
+
+  // Stops accepting elements, waits until all pushed elements have passed
+  // through every stage and joins the stage threads.
+  void close() {
+    if (!started_ || closed_) { return; }
+    closed_ = true;
+    input_finished_.store(true, std::memory_order_release);
+    for (auto& s : stages_) { s.thread.join(); }
+  }
+
+  auto stage_count() const noexcept -> std::size_t { return stages_.size(); }
+
+  // The number of elements the stage has finished processing.
+  auto processed(std::size_t stage) const noexcept -> std::uint64_t {
+    return stages_[stage].processed.load(std::memory_order_relaxed);
+  }
+
+  // The number of elements waiting in front of the stage.
+  auto queued(std::size_t stage) const noexcept -> std::size_t {
+    return stages_[stage].input.size();
+  }
+
+  auto queue_capacity(std::size_t stage) const noexcept -> std::size_t {
+    return stages_[stage].input.capacity();
+  }
+
+  auto get_allocator() const -> allocator_type { return alloc_; }
+
+private:
+  void run_stage(std::size_t index) {
+    auto& self = stages_[index];
+    auto const next
+      = index + 1 < stages_.size() ? &stages_[index + 1] : nullptr;
+    auto const& upstream_finished
+      = index ? stages_[index - 1].finished : input_finished_;
+
+    auto batch = std::vector<T, batch_allocator>(batch_allocator(alloc_));
+    batch.reserve(batch_size_);
+    while (true) {
+      // the flag has to be read before the queue is checked for the last
+      // time, otherwise elements pushed in between would be lost
+      auto const last_round
+        = upstream_finished.load(std::memory_order_acquire);
+      self.input.pop_n(std::back_inserter(batch), batch_size_);
+      if (batch.empty()) {
+        if (last_round) { break; }
+        std::this_thread::yield();
+        continue;
+      }
+
+      self.fn(span<T>(batch.data(), batch.size()));
+      self.processed.fetch_add(batch.size(), std::memory_order_relaxed);
+
+      if (next) {
+        auto first = batch.begin();
+        while (first != batch.end()) {
+          auto const pushed = next->input.push_n(
+            first, static_cast<std::size_t>(batch.end() - first));
+          first += pushed;
+          if (!pushed) { std::this_thread::yield(); }
+        }
+      }
+      batch.clear();
+    }
+    self.finished.store(true, std::memory_order_release);
+  }
+
+  allocator_type alloc_;
+  std::size_t queue_capacity_;
+  std::size_t batch_size_;
+  std::deque<stage, stage_allocator> stages_;
+  bool started_ = false;
+  bool closed_ = false;
+  std::atomic<bool> input_finished_{false};
+};
+
+
+} // namespace xaos
+
+
+#endif // XAOS_PIPELINE_HPP
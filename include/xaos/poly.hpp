@@ -0,0 +1,140 @@
+#ifndef XAOS_POLY_HPP
+#define XAOS_POLY_HPP
+
+
+#include <xaos/detail/poly.hpp>
+#include <xaos/relocate.hpp>
+
+#include <boost/mp11/function.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+
+namespace xaos {
+
+
+struct poly_traits {
+  static constexpr bool is_copyable = true;
+};
+
+// Values whose backends fit into Capacity bytes are stored in the handle
+// instead of being allocated. Besides the value, a backend holds a vtable
+// pointer for each of the interfaces it implements, five for a copyable poly.
+template <std::size_t Capacity = 8 * sizeof(void*)>
+struct inline_poly_traits {
+  static constexpr bool is_copyable = true;
+  static constexpr std::size_t inline_capacity = Capacity;
+};
+
+
+// Holds a value of any type which Interface can be implemented for, in
+// memory obtained from Allocator. Interface is a polymorphic class with a
+// member template
+//
+//   template <class Derived, class Base>
+//   struct implementation : Base { ... };
+//
+// which overrides the virtual functions of Interface for the value returned
+// by static_cast<Derived&>(*this).value(). Traits selects the same options as
+// for functions: is_copyable, thin_handle, deferred_destruction and
+// backend_alignment, and additionally inline_capacity.
+template <
+  class Interface,
+  class Traits = poly_traits,
+  class Allocator = std::allocator<void>>
+class poly
+{
+private:
+  static_assert(std::is_polymorphic<Interface>::value);
+  static_assert(
+    !detail::is_thin_handle_enabled<Traits>::value
+      || !detail::is_deferred_destruction_enabled<Traits>::value,
+    "thin handles do not support deferred destruction");
+  static_assert(
+    !detail::is_inline_storage_enabled<Traits>::value
+      || (!detail::is_thin_handle_enabled<Traits>::value
+          && !detail::is_deferred_destruction_enabled<Traits>::value),
+    "inline storage supports neither thin handles nor deferred destruction");
+
+  using storage_t = detail::poly_storage<
+    Interface,
+    Traits,
+    typename std::allocator_traits<Allocator>::template rebind_alloc<void>>;
+  storage_t storage_;
+
+public:
+  using interface_type = Interface;
+  using traits_type = Traits;
+  using allocator_type = typename storage_t::allocator_type;
+
+  template <class T>
+  poly(T value, allocator_type alloc = allocator_type())
+    : storage_(std::move(alloc), std::move(value)) {}
+
+  // Allocator-extended move and copy. A poly stored in an allocator-aware
+  // container, or in another poly, uses the allocator of the enclosing one.
+  poly(std::allocator_arg_t, allocator_type const& alloc, poly&& other)
+    : storage_(std::allocator_arg, alloc, std::move(other.storage_)) {}
+
+  template <
+    class Storage = storage_t,
+    class = std::enable_if_t<std::is_copy_constructible<Storage>::value>>
+  poly(std::allocator_arg_t, allocator_type const& alloc, poly const& other)
+    : storage_(std::allocator_arg, alloc, other.storage_) {}
+
+  auto operator->() -> Interface* { return std::addressof(**this); }
+  auto operator->() const -> Interface const* {
+    return std::addressof(**this);
+  }
+
+  auto operator*() -> Interface& { return *storage_; }
+  auto operator*() const -> Interface const& { return *storage_; }
+
+  // Whether the poly holds a value. Only moved from objects are empty.
+  explicit operator bool() const noexcept { return !storage_.empty(); }
+
+  auto get_allocator() const -> allocator_type {
+    return storage_.get_allocator();
+  }
+
+  // Moves the value into memory obtained from alloc and releases the memory
+  // it used to occupy. The poly must not be empty.
+  void reallocate(allocator_type alloc) {
+    storage_.reallocate(std::move(alloc));
+  }
+
+  void swap(poly& other) noexcept(
+    noexcept(std::declval<storage_t&>().swap(std::declval<storage_t&>()))) {
+    storage_.swap(other.storage_);
+  }
+};
+
+
+template <class Interface, class Traits, class Allocator>
+void swap(
+  poly<Interface, Traits, Allocator>& l,
+  poly<Interface, Traits, Allocator>& r) noexcept(noexcept(l.swap(r))) {
+  l.swap(r);
+}
+
+
+// The handle holds nothing but a pointer to the backend and, unless the
+// handle is thin, the allocator. Inline backends are moved by their values,
+// and fancy pointers, like offset pointers, may depend on their address.
+template <class Interface, class Traits, class Allocator>
+struct is_trivially_relocatable<poly<Interface, Traits, Allocator>>
+  : boost::mp11::mp_and<
+      boost::mp11::mp_not<detail::is_inline_storage_enabled<Traits>>,
+      std::is_pointer<detail::handle_pointer<Allocator, Interface>>,
+      boost::mp11::mp_or<
+        detail::is_thin_handle_enabled<Traits>,
+        std::is_trivially_copyable<Allocator>>> {};
+
+
+} // namespace xaos
+
+
+#endif // XAOS_POLY_HPP
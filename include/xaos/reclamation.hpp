@@ -0,0 +1,127 @@
+#ifndef XAOS_RECLAMATION_HPP
+#define XAOS_RECLAMATION_HPP
+
+
+#include <xaos/detail/reclamation.hpp>
+#include <xaos/function.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+
+namespace xaos {
+
+
+struct deferred_function_traits {
+  static constexpr bool is_copyable = true;
+  static constexpr bool lvalue_ref_call = true;
+  static constexpr bool deferred_destruction = true;
+};
+
+struct deferred_rfunction_traits {
+  static constexpr bool rvalue_ref_call = true;
+  static constexpr bool deferred_destruction = true;
+};
+
+
+template <class Signature, class Allocator = std::allocator<void>>
+using deferred_function
+  = basic_function<Signature, deferred_function_traits, Allocator>;
+
+template <class Signature, class Allocator = std::allocator<void>>
+using deferred_rfunction
+  = basic_function<Signature, deferred_rfunction_traits, Allocator>;
+
+
+using detail::reclamation_queue;
+
+
+// The queue that receives backends of functions with deferred destruction.
+// It is only drained by collect, drain and reclamation threads, never at
+// exit, so programs have to drain it at a point where the allocators of the
+// backends are still alive, typically before returning from main. Backends
+// left in it at exit are leaked.
+inline auto default_reclamation_queue() noexcept -> reclamation_queue& {
+  return detail::default_reclamation_queue();
+}
+
+// Destroys all backends handed over for deferred destruction so far.
+// Returns the number of destroyed backends.
+inline auto collect() noexcept -> std::size_t {
+  return default_reclamation_queue().collect();
+}
+
+// Collects until the default queue stays empty, including backends handed
+// over while others are destroyed. Meant for shutdown. Returns the number of
+// destroyed backends.
+inline auto drain() noexcept -> std::size_t {
+  return default_reclamation_queue().drain();
+}
+
+
+// Periodically collects a reclamation queue on a background thread. The
+// queue is drained when the object is destroyed.
+class reclamation_thread
+{
+public:
+  explicit reclamation_thread(
+    std::chrono::steady_clock::duration interval
+    = std::chrono::milliseconds(10),
+    reclamation_queue& queue = default_reclamation_queue())
+    : queue_(queue)
+    , interval_(interval)
+    , thread_([this] { run(); }) {}
+
+  reclamation_thread(reclamation_thread const&) = delete;
+  auto operator=(reclamation_thread const&) -> reclamation_thread& = delete;
+
+  ~reclamation_thread() {
+    {
+      auto lock = std::unique_lock<std::mutex>(mutex_);
+      stopped_ = true;
+    }
+    wakeup_.notify_one();
+    thread_.join();
+    queue_.drain();
+  }
+
+  // Wakes up the thread to drain the queue without waiting for the interval
+  // to pass.
+  void notify() {
+    {
+      auto lock = std::unique_lock<std::mutex>(mutex_);
+      notified_ = true;
+    }
+    wakeup_.notify_one();
+  }
+
+private:
+  void run() {
+    auto lock = std::unique_lock<std::mutex>(mutex_);
+    while (!stopped_) {
+      lock.unlock();
+      queue_.collect();
+      lock.lock();
+      wakeup_.wait_for(
+        lock, interval_, [this] { return stopped_ || notified_; });
+      notified_ = false;
+    }
+  }
+
+  reclamation_queue& queue_;
+  std::chrono::steady_clock::duration interval_;
+  std::mutex mutex_;
+  std::condition_variable wakeup_;
+  bool stopped_ = false;
+  bool notified_ = false;
+  std::thread thread_;
+};
+
+
+} // namespace xaos
+
+
+#endif // XAOS_RECLAMATION_HPP
@@ -0,0 +1,55 @@
+#ifndef XAOS_RELOCATE_HPP
+#define XAOS_RELOCATE_HPP
+
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+namespace xaos {
+
+
+// Customization point. A type is trivially relocatable, if moving an object
+// to a new location and destroying the original is equivalent to copying its
+// bytes and forgetting about the original.
+template <class T>
+struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+template <class T>
+constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
+
+// Moves n objects starting at first into uninitialized storage starting at
+// d_first and ends the lifetime of the originals. The ranges may overlap, as
+// long as d_first does not come after first. Returns the end of the
+// destination range.
+template <class T>
+auto relocate_n(T* first, std::size_t n, T* d_first) noexcept(
+  is_trivially_relocatable<T>::value
+  || std::is_nothrow_move_constructible<T>::value) -> T* {
+  if constexpr (is_trivially_relocatable<T>::value) {
+    if (n) {
+      std::memmove(
+        static_cast<void*>(d_first),
+        static_cast<void const*>(first),
+        n * sizeof(T));
+    }
+    return d_first + n;
+  } else {
+    if (first == d_first) { return d_first + n; }
+    for (; n; --n, ++first, ++d_first) {
+      ::new (static_cast<void*>(d_first)) T(std::move(*first));
+      first->~T();
+    }
+    return d_first;
+  }
+}
+
+
+} // namespace xaos
+
+
+#endif // XAOS_RELOCATE_HPP
@@ -0,0 +1,96 @@
+#ifndef XAOS_SPAN_HPP
+#define XAOS_SPAN_HPP
+
+
+#include <boost/assert.hpp>
+
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+
+
+namespace xaos {
+
+
+// A minimal stand-in for C++20 std::span with dynamic extent.
+template <class T>
+class span
+{
+private:
+  template <class U>
+  using is_compatible = std::is_convertible<U (*)[], T (*)[]>;
+
+  template <class Container>
+  using container_element = std::remove_pointer_t<decltype(
+    std::data(std::declval<Container&>()))>;
+
+public:
+  using element_type = T;
+  using value_type = std::remove_cv_t<T>;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using pointer = T*;
+  using reference = T&;
+  using iterator = T*;
+
+  constexpr span() noexcept = default;
+
+  constexpr span(pointer data, size_type size) noexcept
+    : data_(data), size_(size) {}
+
+  template <std::size_t N>
+  constexpr span(element_type (&array)[N]) noexcept : span(array, N) {}
+
+  template <
+    class Container,
+    std::enable_if_t<
+      !std::is_array<Container>::value
+        && is_compatible<container_element<Container>>::value,
+      int> = 0>
+  constexpr span(Container& container)
+    : span(std::data(container), std::size(container)) {}
+
+  template <
+    class Container,
+    std::enable_if_t<
+      !std::is_array<Container>::value
+        && is_compatible<container_element<Container const>>::value,
+      int> = 0>
+  constexpr span(Container const& container)
+    : span(std::data(container), std::size(container)) {}
+
+  template <class U, std::enable_if_t<is_compatible<U>::value, int> = 0>
+  constexpr span(span<U> other) noexcept : span(other.data(), other.size()) {}
+
+  constexpr auto data() const noexcept -> pointer { return data_; }
+  constexpr auto size() const noexcept -> size_type { return size_; }
+  constexpr auto empty() const noexcept -> bool { return !size_; }
+
+  constexpr auto begin() const noexcept -> iterator { return data_; }
+  constexpr auto end() const noexcept -> iterator { return data_ + size_; }
+
+  constexpr auto operator[](size_type n) const -> reference {
+    BOOST_ASSERT(n < size_);
+    return data_[n];
+  }
+
+  constexpr auto first(size_type count) const -> span {
+    BOOST_ASSERT(count <= size_);
+    return {data_, count};
+  }
+
+  constexpr auto subspan(size_type offset) const -> span {
+    BOOST_ASSERT(offset <= size_);
+    return {data_ + offset, size_ - offset};
+  }
+
+private:
+  pointer data_ = nullptr;
+  size_type size_ = 0;
+};
+
+
+} // namespace xaos
+
+
+#endif // XAOS_SPAN_HPP
@@ -0,0 +1,175 @@
+#ifndef XAOS_STRAND_HPP
+#define XAOS_STRAND_HPP
+
+
+#include <xaos/detail/function_alloc.hpp>
+#include <xaos/detail/mpsc_queue.hpp>
+#include <xaos/function.hpp>
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <type_traits>
+
+
+namespace xaos {
+namespace detail {
+
+
+template <class Task, class Allocator>
+struct strand_node
+  : mpsc_hook
+  , pointer_storage_helper<strand_node<Task, Allocator>, Allocator, 0> {
+  using pointer_holder_t = pointer_storage_helper<strand_node, Allocator, 0>;
+
+  template <class Callable>
+  strand_node(
+    typename pointer_holder_t::pointer ptr,
+    Callable&& callable,
+    Allocator const& alloc)
+    : pointer_holder_t(std::move(ptr)) {
+    if constexpr (std::is_same<std::decay_t<Callable>, Task>::value) {
+      task.emplace(static_cast<Callable&&>(callable));
+    } else {
+      task.emplace(static_cast<Callable&&>(callable), alloc);
+    }
+  }
+
+  std::optional<Task> task;
+};
+
+
+inline auto current_strand() noexcept -> void const*& {
+  thread_local void const* current = nullptr;
+  return current;
+}
+
+
+} // namespace detail
+
+
+// Serializes execution of tasks posted from any number of threads without
+// locks. A thread which posts a task to an idle strand claims it and runs
+// queued tasks until the queue is drained; posting to a busy strand only
+// enqueues the task.
+template <class Allocator = std::allocator<void>>
+class strand
+{
+public:
+  using allocator_type =
+    typename std::allocator_traits<Allocator>::template rebind_alloc<void>;
+  using task_type = rfunction<void(), allocator_type>;
+
+private:
+  using node_type = detail::strand_node<task_type, allocator_type>;
+  using node_alloc_traits = typename std::allocator_traits<
+    allocator_type>::template rebind_traits<node_type>;
+  using node_allocator = typename node_alloc_traits::allocator_type;
+
+public:
+  explicit strand(allocator_type alloc = allocator_type()) : alloc_(alloc) {}
+
+  strand(strand const&) = delete;
+  auto operator=(strand const&) -> strand& = delete;
+
+  // pending tasks are destroyed without being run
+  ~strand() {
+    while (!queue_.empty()) {
+      if (auto const hook = queue_.pop()) {
+        delete_node(static_cast<node_type*>(hook));
+      }
+    }
+  }
+
+  // Enqueues the task and, if the strand is idle, runs pending tasks on the
+  // calling thread before returning. If a task throws, the exception
+  // propagates and remaining tasks are run by a subsequent post or poll.
+  template <class Callable>
+  void post(Callable&& callable) {
+    auto alloc = node_allocator(alloc_);
+    auto const node
+      = detail::new_backend(alloc, static_cast<Callable&&>(callable), alloc_);
+    queue_.push(*node);
+    poll();
+  }
+
+  // Runs pending tasks if no other thread does. Returns the number of tasks
+  // run.
+  auto poll() -> std::size_t {
+    auto executed = std::size_t(0);
+    while (try_claim()) {
+      executed += run_pending();
+      running_.store(false, std::memory_order_seq_cst);
+      if (queue_.empty()) { break; }
+    }
+    return executed;
+  }
+
+  auto running_in_this_thread() const noexcept -> bool {
+    return detail::current_strand() == this;
+  }
+
+  auto get_allocator() const -> allocator_type { return alloc_; }
+
+private:
+  auto try_claim() noexcept -> bool {
+    // the load pairs with the release of the strand followed by the check for
+    // emptiness in poll, so that a task cannot be left behind
+    return !running_.load(std::memory_order_seq_cst)
+           && !running_.exchange(true, std::memory_order_acquire);
+  }
+
+  auto run_pending() -> std::size_t {
+    struct guard {
+      strand* self;
+      void const* previous = detail::current_strand();
+      int exceptions = std::uncaught_exceptions();
+
+      ~guard() {
+        detail::current_strand() = previous;
+        if (std::uncaught_exceptions() > exceptions) {
+          self->running_.store(false, std::memory_order_seq_cst);
+        }
+      }
+    } const g{this};
+    detail::current_strand() = this;
+
+    auto executed = std::size_t(0);
+    while (true) {
+      auto const hook = queue_.pop();
+      if (!hook) {
+        if (queue_.empty()) { break; }
+        // a producer is in the middle of pushing
+        std::this_thread::yield();
+        continue;
+      }
+
+      auto const node = static_cast<node_type*>(hook);
+      auto task = std::move(*node->task);
+      delete_node(node);
+
+      ++executed;
+      std::move(task)();
+    }
+    return executed;
+  }
+
+  void delete_node(node_type* node) noexcept {
+    auto alloc = node_allocator(alloc_);
+    auto const ptr = node->pointer_to(*node);
+    node_alloc_traits::destroy(alloc, node);
+    node_alloc_traits::deallocate(alloc, ptr, 1);
+  }
+
+  allocator_type alloc_;
+  std::atomic<bool> running_{false};
+  detail::mpsc_queue queue_;
+};
+
+
+} // namespace xaos
+
+
+#endif // XAOS_STRAND_HPP
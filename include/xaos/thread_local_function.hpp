@@ -0,0 +1,106 @@
+#ifndef XAOS_THREAD_LOCAL_FUNCTION_HPP
+#define XAOS_THREAD_LOCAL_FUNCTION_HPP
+
+
+#include <xaos/detail/thread_replicas.hpp>
+#include <xaos/function.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+
+namespace xaos {
+
+
+// Calls a separate copy of a function on every thread. The copy is cloned
+// from the prototype on the first call from a thread and afterwards called
+// without synchronization, so stateful callables need no locking.
+//
+// Replicas live until the thread_local_function is destroyed, which must not
+// happen while other threads call it. Each thread keeps a small entry for
+// every live thread_local_function it has called.
+template <class Signature, class Allocator = std::allocator<void>>
+class thread_local_function
+{
+public:
+  using function_type = function<Signature, Allocator>;
+  using allocator_type = typename function_type::allocator_type;
+
+  explicit thread_local_function(function_type prototype)
+    : prototype_(std::move(prototype))
+    , replicas_(replica_allocator(prototype_.get_allocator())) {}
+
+  thread_local_function(thread_local_function const&) = delete;
+  auto operator=(thread_local_function const&)
+    -> thread_local_function& = delete;
+
+  template <class... Args>
+  auto operator()(Args&&... args) -> decltype(
+    std::declval<function_type&>()(static_cast<Args&&>(args)...)) {
+    return local()(static_cast<Args&&>(args)...);
+  }
+
+  // The replica of the calling thread, created on first use.
+  auto local() -> function_type& {
+    auto& last = detail::last_replica();
+    if (last.owner == owner_.id) {
+      return *static_cast<function_type*>(last.replica);
+    }
+
+    auto& replica = find_or_clone();
+    last = detail::replica_entry{owner_.id, &replica};
+    return replica;
+  }
+
+  // Calls f with every replica, for example to merge per-thread state. Must
+  // not run concurrently with calls of the replicas.
+  template <class F>
+  void for_each_replica(F f) {
+    auto lock = std::lock_guard<std::mutex>(mutex_);
+    for (auto& replica : replicas_) { f(replica); }
+  }
+
+  auto replica_count() const -> std::size_t {
+    auto lock = std::lock_guard<std::mutex>(mutex_);
+    return replicas_.size();
+  }
+
+  auto get_allocator() const -> allocator_type {
+    return prototype_.get_allocator();
+  }
+
+private:
+  using replica_allocator = typename std::allocator_traits<
+    allocator_type>::template rebind_alloc<function_type>;
+
+  auto find_or_clone() -> function_type& {
+    auto& replicas = detail::thread_replicas();
+    if (auto const found = replicas.find(owner_.id)) {
+      return *static_cast<function_type*>(found);
+    }
+
+    auto lock = std::unique_lock<std::mutex>(mutex_);
+    auto& replica = replicas_.emplace_back(prototype_);
+    lock.unlock();
+
+    replicas.insert(owner_.id, &replica);
+    return replica;
+  }
+
+  detail::replica_owner const owner_;
+  function_type const prototype_;
+
+  mutable std::mutex mutex_;
+  // elements of a deque stay in place when it grows at the end
+  std::deque<function_type, replica_allocator> replicas_;
+};
+
+
+} // namespace xaos
+
+
+#endif // XAOS_THREAD_LOCAL_FUNCTION_HPP
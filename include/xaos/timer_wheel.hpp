@@ -0,0 +1,250 @@
+#ifndef XAOS_TIMER_WHEEL_HPP
+#define XAOS_TIMER_WHEEL_HPP
+
+
+#include <xaos/detail/timer_wheel.hpp>
+#include <xaos/function.hpp>
+
+#include <array>
+#include <memory>
+#include <type_traits>
+
+
+namespace xaos {
+
+
+// Hierarchical timing wheel. Time is measured in ticks advanced explicitly by
+// the owner. Scheduling and cancellation are O(1), all timers expiring at a
+// tick are run as a batch. Timer nodes are recycled through a free list and,
+// like the callbacks, obtained from the wheel's allocator.
+template <class Allocator = std::allocator<void>>
+class timer_wheel
+{
+public:
+  using allocator_type =
+    typename std::allocator_traits<Allocator>::template rebind_alloc<void>;
+  using callback_type = rfunction<void(), allocator_type>;
+
+private:
+  using node_type = detail::timer_node<callback_type, allocator_type>;
+  using node_alloc_traits = typename std::allocator_traits<
+    allocator_type>::template rebind_traits<node_type>;
+  using node_allocator = typename node_alloc_traits::allocator_type;
+
+public:
+  class timer_id
+  {
+  public:
+    timer_id() = default;
+
+  private:
+    friend class timer_wheel;
+
+    timer_id(node_type* node, std::uint64_t generation)
+      : node_(node), generation_(generation) {}
+
+    node_type* node_ = nullptr;
+    std::uint64_t generation_ = 0;
+  };
+
+  explicit timer_wheel(allocator_type alloc = allocator_type())
+    : alloc_(alloc) {}
+
+  timer_wheel(timer_wheel const&) = delete;
+  auto operator=(timer_wheel const&) -> timer_wheel& = delete;
+
+  ~timer_wheel() {
+    destroy_list(expired_);
+    for (auto& level : wheel_) {
+      for (auto& slot : level) { destroy_list(slot); }
+    }
+
+    while (free_) {
+      auto const node = free_;
+      free_ = node->next_free;
+      deallocate_node(node);
+    }
+  }
+
+  // Schedules the callback to run when the wheel is advanced by delay ticks.
+  // Delays less than one tick are treated as one tick.
+  template <class Callable>
+  auto schedule(std::uint64_t delay, Callable callable) -> timer_id {
+    auto const node = make_node();
+    try {
+      if constexpr (std::is_same<Callable, callback_type>::value) {
+        node->callback.emplace(std::move(callable));
+      } else {
+        node->callback.emplace(std::move(callable), alloc_);
+      }
+    } catch (...) {
+      recycle_node(node);
+      throw;
+    }
+
+    node->deadline = now_ + (delay ? delay : 1);
+    insert(*node);
+    ++size_;
+    return timer_id(node, node->generation);
+  }
+
+  // Returns false if the timer has already expired or was cancelled.
+  auto cancel(timer_id id) -> bool {
+    auto const node = id.node_;
+    if (!node || node->generation != id.generation_) { return false; }
+
+    node->unlink();
+    --size_;
+    --level_sizes_[node->level];
+    recycle_node(node);
+    return true;
+  }
+
+  // Advances the wheel and runs expired callbacks. If a callback throws, the
+  // exception propagates and timers that expired at the same tick are run by
+  // the next call to advance. Returns the number of callbacks run.
+  auto advance(std::uint64_t ticks = 1) -> std::size_t {
+    auto fired = run_expired();
+    for (; ticks; --ticks) {
+      auto const idle = idle_ticks();
+      if (idle >= ticks) {
+        now_ += ticks;
+        break;
+      }
+      now_ += idle;
+      ticks -= idle;
+
+      ++now_;
+      cascade();
+      expired_.splice(wheel_[0][slot_index(now_, 0)]);
+      fired += run_expired();
+    }
+    return fired;
+  }
+
+  auto now() const noexcept -> std::uint64_t { return now_; }
+  auto size() const noexcept -> std::size_t { return size_; }
+  auto empty() const noexcept -> bool { return !size_; }
+
+  auto get_allocator() const -> allocator_type { return alloc_; }
+
+private:
+  static constexpr auto slot_bits = detail::timer_wheel_slot_bits;
+  static constexpr auto slot_count = detail::timer_wheel_slots;
+  static constexpr auto level_count = detail::timer_wheel_levels;
+  static constexpr auto max_delta
+    = (std::uint64_t(1) << (slot_bits * level_count)) - 1;
+
+  static auto slot_index(std::uint64_t time, unsigned level) noexcept
+    -> std::size_t {
+    return (time >> (slot_bits * level)) & (slot_count - 1);
+  }
+
+  // the number of following ticks during which no timer can expire
+  auto idle_ticks() const noexcept -> std::uint64_t {
+    auto level = 0u;
+    while (level < level_count && !level_sizes_[level]) { ++level; }
+
+    if (level == level_count) { return std::uint64_t(-1); }
+    if (level == 0) { return 0; }
+
+    // nothing happens until the next cascade from the lowest non-empty level
+    auto const mask = (std::uint64_t(1) << (slot_bits * level)) - 1;
+    return mask - (now_ & mask);
+  }
+
+  void insert(node_type& node) {
+    auto const delta = node.deadline - now_;
+    auto level = 0u;
+    while (
+      level + 1 < level_count
+      && delta >> (slot_bits * (level + 1)) != 0) {
+      ++level;
+    }
+
+    auto const time = delta > max_delta ? now_ + max_delta : node.deadline;
+    node.link_before(wheel_[level][slot_index(time, level)]);
+    node.level = level;
+    ++level_sizes_[level];
+  }
+
+  void cascade() {
+    for (auto level = 1u; level < level_count; ++level) {
+      if (slot_index(now_, level - 1) != 0) { break; }
+
+      auto pending = detail::list_hook();
+      pending.splice(wheel_[level][slot_index(now_, level)]);
+      while (!pending.empty()) {
+        auto& node = static_cast<node_type&>(*pending.next);
+        node.unlink();
+        --level_sizes_[node.level];
+        insert(node);
+      }
+    }
+  }
+
+  auto run_expired() -> std::size_t {
+    auto fired = std::size_t(0);
+    while (!expired_.empty()) {
+      auto const node = static_cast<node_type*>(expired_.next);
+      node->unlink();
+      --size_;
+      --level_sizes_[node->level];
+
+      auto callback = std::move(*node->callback);
+      recycle_node(node);
+
+      ++fired;
+      std::move(callback)();
+    }
+    return fired;
+  }
+
+  auto make_node() -> node_type* {
+    if (free_) {
+      auto const node = free_;
+      free_ = node->next_free;
+      return node;
+    }
+
+    auto alloc = node_allocator(alloc_);
+    return detail::new_backend(alloc);
+  }
+
+  void recycle_node(node_type* node) noexcept {
+    node->callback.reset();
+    ++node->generation;
+    node->next_free = free_;
+    free_ = node;
+  }
+
+  void deallocate_node(node_type* node) noexcept {
+    auto alloc = node_allocator(alloc_);
+    auto const ptr = node->pointer_to(*node);
+    node_alloc_traits::destroy(alloc, node);
+    node_alloc_traits::deallocate(alloc, ptr, 1);
+  }
+
+  void destroy_list(detail::list_hook& list) noexcept {
+    while (!list.empty()) {
+      auto const node = static_cast<node_type*>(list.next);
+      node->unlink();
+      node->callback.reset();
+      deallocate_node(node);
+    }
+  }
+
+  allocator_type alloc_;
+  std::uint64_t now_ = 0;
+  std::size_t size_ = 0;
+  node_type* free_ = nullptr;
+  detail::list_hook expired_;
+  std::array<std::size_t, level_count> level_sizes_ = {};
+  std::array<std::array<detail::list_hook, slot_count>, level_count> wheel_;
+};
+
+
+} // namespace xaos
+
+
+#endif // XAOS_TIMER_WHEEL_HPP
@@ -0,0 +1,196 @@
+#include <xaos/batched_function.hpp>
+
+#include <boost/core/lightweight_test.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+
+namespace {
+
+
+struct record {
+  int source;
+  int sequence;
+};
+
+
+} // namespace
+
+
+int main() {
+  // test calls are delivered in batches
+  {
+    auto batches = std::vector<std::vector<int>>();
+    {
+      auto f = xaos::batched_function<void(int)>(
+        [&](xaos::span<int const> batch) {
+          batches.emplace_back(batch.begin(), batch.end());
+        },
+        3);
+      BOOST_TEST_EQ(f.batch_size(), 3u);
+      for (int i = 0; i != 7; ++i) { f(i); }
+      BOOST_TEST_EQ(batches.size(), 2u);
+
+      f.flush();
+      BOOST_TEST_EQ(batches.size(), 3u);
+      f.flush();
+      BOOST_TEST_EQ(batches.size(), 3u);
+
+      f(7);
+    }
+    // the destructor delivers the rest
+    BOOST_TEST_EQ(batches.size(), 4u);
+    BOOST_TEST((batches[0] == std::vector<int>{0, 1, 2}));
+    BOOST_TEST((batches[1] == std::vector<int>{3, 4, 5}));
+    BOOST_TEST((batches[2] == std::vector<int>{6}));
+    BOOST_TEST((batches[3] == std::vector<int>{7}));
+  }
+
+  // test several arguments are stored as tuples
+  {
+    using batched = xaos::batched_function<void(std::string const&, int)>;
+    static_assert(std::is_same<
+                  batched::value_type,
+                  std::tuple<std::string, int>>::value);
+
+    auto total = std::string();
+    auto f = batched(
+      [&](xaos::span<std::tuple<std::string, int> const> batch) {
+        for (auto const& [s, n] : batch) { total.append(s, 0, n); }
+      },
+      2);
+    auto const word = std::string("abc");
+    f(word, 1);
+    f(word, 2);
+    BOOST_TEST_EQ(total, "aab");
+  }
+
+  // test partial batches are delivered by flush_expired after the delay
+  {
+    auto sizes = std::vector<std::size_t>();
+    auto f = xaos::batched_function<void(int)>(
+      [&](xaos::span<int const> batch) { sizes.push_back(batch.size()); },
+      100,
+      std::chrono::milliseconds(50));
+    f(1);
+    f(2);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    // calls do not check the delay
+    f(3);
+    BOOST_TEST(sizes.empty());
+    f.flush_expired();
+    BOOST_TEST((sizes == std::vector<std::size_t>{3}));
+
+    // the next batch gets its own deadline
+    f(4);
+    f.flush_expired();
+    BOOST_TEST((sizes == std::vector<std::size_t>{3}));
+    f.flush();
+    BOOST_TEST((sizes == std::vector<std::size_t>{3, 1}));
+  }
+
+  // test expired buffers of idle threads are flushed by other threads
+  {
+    auto delivered = std::vector<int>();
+    auto f = xaos::batched_function<void(int)>(
+      [&](xaos::span<int const> batch) {
+        delivered.insert(delivered.end(), batch.begin(), batch.end());
+      },
+      100,
+      std::chrono::milliseconds(200));
+    std::thread([&] {
+      f(1);
+      f(2);
+    }).join();
+
+    f.flush_expired();
+    BOOST_TEST(delivered.empty());
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    f.flush_expired();
+    BOOST_TEST((delivered == std::vector<int>{1, 2}));
+  }
+
+  // test the destructor swallows exceptions of the sink
+  {
+    auto calls = 0;
+    {
+      auto f = xaos::batched_function<void(int)>(
+        [&](xaos::span<int const>) {
+          ++calls;
+          throw std::runtime_error("sink");
+        },
+        10);
+      f(1);
+    }
+    BOOST_TEST_EQ(calls, 1);
+  }
+
+  // test a throwing sink discards the batch
+  {
+    auto calls = 0;
+    auto f = xaos::batched_function<void(int)>(
+      [&](xaos::span<int const> batch) {
+        ++calls;
+        if (batch[0] == 0) { throw std::runtime_error("sink"); }
+      },
+      2);
+    f(0);
+    BOOST_TEST_THROWS(f(1), std::runtime_error);
+    f(2);
+    f(3);
+    BOOST_TEST_EQ(calls, 2);
+  }
+
+  // test batches from several threads keep the order of every thread
+  {
+    auto const thread_count = 4;
+    auto const per_thread = 1000;
+    auto received = std::vector<std::vector<int>>(thread_count);
+    auto in_sink = 0;
+    auto overlapped = false;
+    {
+      auto f = xaos::batched_function<void(record const&)>(
+        [&](xaos::span<record const> batch) {
+          overlapped = overlapped || in_sink++;
+          for (auto const& r : batch) {
+            received[r.source].push_back(r.sequence);
+          }
+          --in_sink;
+        },
+        16);
+
+      auto producing = std::atomic<int>(thread_count);
+      auto threads = std::vector<std::thread>();
+      for (int t = 0; t != thread_count; ++t) {
+        threads.emplace_back([&f, &producing, t] {
+          for (int i = 0; i != per_thread; ++i) { f(record{t, i}); }
+          --producing;
+        });
+      }
+      // flushing runs concurrently with calls
+      while (producing.load()) {
+        f.flush_all();
+        std::this_thread::yield();
+      }
+      for (auto& t : threads) { t.join(); }
+      f.flush_all();
+    }
+
+    BOOST_TEST(!overlapped);
+    for (auto const& sequence : received) {
+      BOOST_TEST_EQ(sequence.size(), std::size_t(per_thread));
+      for (int i = 0; i != static_cast<int>(sequence.size()); ++i) {
+        BOOST_TEST_EQ(sequence[i], i);
+      }
+    }
+  }
+
+  return boost::report_errors();
+}
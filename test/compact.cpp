@@ -0,0 +1,162 @@
+#include <xaos/arena.hpp>
+#include <xaos/compact.hpp>
+#include <xaos/function.hpp>
+
+#include <boost/core/lightweight_test.hpp>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+namespace {
+
+
+struct constant {
+  auto operator()() const -> int { return value; }
+
+  int value;
+  char padding[100] = {};
+};
+
+
+// Reports where its state was allocated.
+struct allocator_aware {
+  using allocator_type = xaos::arena_allocator<int>;
+
+  allocator_aware() : values(100) {}
+
+  allocator_aware(
+    std::allocator_arg_t, allocator_type alloc, allocator_aware const& other)
+    : values(other.values, alloc) {}
+
+  allocator_aware(
+    std::allocator_arg_t, allocator_type alloc, allocator_aware&& other)
+    : values(std::move(other.values), alloc) {}
+
+  auto operator()() const -> xaos::arena* {
+    return values.get_allocator().resource();
+  }
+
+  std::vector<int, allocator_type> values;
+};
+
+
+} // namespace
+
+
+int main() {
+  // test arena
+  {
+    auto a = xaos::arena(128);
+    auto const p1 = a.allocate(10, 1);
+    auto const p2 = a.allocate(8, 8);
+    BOOST_TEST_EQ(reinterpret_cast<std::uintptr_t>(p2) % 8, 0u);
+    BOOST_TEST(static_cast<char*>(p2) >= static_cast<char*>(p1) + 10);
+    BOOST_TEST_EQ(a.bytes_allocated(), 18u);
+
+    // larger than a chunk
+    auto const p3 = static_cast<char*>(a.allocate(1000, 16));
+    BOOST_TEST_EQ(reinterpret_cast<std::uintptr_t>(p3) % 16, 0u);
+    p3[999] = 1;
+
+    a.release();
+    BOOST_TEST_EQ(a.bytes_allocated(), 0u);
+  }
+
+  // test arena_allocator
+  {
+    auto a = xaos::arena();
+    auto const heap = xaos::arena_allocator<int>();
+    auto const in_arena = xaos::arena_allocator<int>(a);
+    BOOST_TEST(heap != in_arena);
+    BOOST_TEST(in_arena == xaos::arena_allocator<double>(in_arena));
+    BOOST_TEST(
+      std::allocator_traits<xaos::arena_allocator<int>>::
+        select_on_container_copy_construction(in_arena)
+      == heap);
+
+    auto alloc = in_arena;
+    auto const ptr = alloc.allocate(4);
+    BOOST_TEST_EQ(a.bytes_allocated(), 4 * sizeof(int));
+    alloc.deallocate(ptr, 4);
+  }
+
+  // test compaction
+  {
+    using alloc_type = xaos::arena_allocator<void>;
+    using F = xaos::function<int(), alloc_type>;
+
+    auto table = std::vector<F>();
+    {
+      auto old_arena = xaos::arena();
+      for (int i = 0; i < 10; ++i) {
+        if (i % 2) {
+          table.emplace_back([i] { return i; }, alloc_type(old_arena));
+        } else {
+          table.emplace_back(constant{i});
+        }
+      }
+      auto moved_from = std::move(table[3]);
+
+      auto new_arena = xaos::arena();
+      BOOST_TEST_EQ(xaos::compact(table, alloc_type(new_arena)), 9u);
+      BOOST_TEST_EQ(xaos::compact(table, alloc_type()), 9u);
+
+      // the old arena is released
+    }
+
+    for (int i = 0; i < 10; ++i) {
+      if (i != 3) {
+        BOOST_TEST_EQ(table[i](), i);
+        BOOST_TEST(table[i].get_allocator() == alloc_type());
+      }
+    }
+  }
+
+  // test compaction of thin handles
+  {
+    using alloc_type = xaos::arena_allocator<void>;
+    using F = xaos::thin_function<int(), alloc_type>;
+
+    auto a = xaos::arena();
+    auto table = std::array<F, 3>{
+      F([] { return 0; }), F([] { return 1; }), F([] { return 2; })};
+    BOOST_TEST_EQ(xaos::compact(table, alloc_type(a)), 3u);
+    BOOST_TEST(a.bytes_allocated() > 0);
+    for (int i = 0; i < 3; ++i) {
+      BOOST_TEST_EQ(table[i](), i);
+      BOOST_TEST_EQ(table[i].get_allocator().resource(), &a);
+    }
+
+    table[1] = F([] { return 5; });
+    BOOST_TEST_EQ(table[1](), 5);
+    BOOST_TEST(table[1].get_allocator() == alloc_type());
+  }
+
+  // test uses-allocator construction
+  {
+    using alloc_type = xaos::arena_allocator<void>;
+    using F = xaos::function<xaos::arena*(), alloc_type>;
+
+    auto a = xaos::arena();
+    auto f = F(allocator_aware(), alloc_type(a));
+    BOOST_TEST_EQ(f(), &a);
+    BOOST_TEST(a.bytes_allocated() > 100 * sizeof(int));
+
+    // copies are allocated from the free store along with their state
+    auto g = f;
+    BOOST_TEST(g() == nullptr);
+
+    auto b = xaos::arena();
+    auto table = std::vector<F>();
+    table.emplace_back(allocator_aware());
+    BOOST_TEST(table[0]() == nullptr);
+    BOOST_TEST_EQ(xaos::compact(table, alloc_type(b)), 1u);
+    BOOST_TEST_EQ(table[0](), &b);
+    BOOST_TEST(b.bytes_allocated() > 100 * sizeof(int));
+  }
+
+  return boost::report_errors();
+}
@@ -0,0 +1,194 @@
+#include <xaos/completion_handler.hpp>
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/core/lightweight_test.hpp>
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "counting_allocator.hpp"
+
+
+namespace {
+
+
+// A handler with an associated allocator, as Asio finds it.
+struct allocating_handler {
+  using allocator_type = counting_allocator<int>;
+
+  auto get_allocator() const -> allocator_type { return alloc; }
+
+  void operator()(int x) { *result = x; }
+
+  allocator_type alloc;
+  int* result;
+};
+
+
+// Keeps one freed block for reuse, like the recycling allocator Asio uses
+// for handler memory.
+struct recycling_slot {
+  void* block = nullptr;
+  std::size_t size = 0;
+  int allocations = 0;
+
+  ~recycling_slot() { ::operator delete(block); }
+};
+
+template <class T>
+class recycling_allocator
+{
+public:
+  using value_type = T;
+
+  recycling_allocator(recycling_slot& slot) : slot(&slot) {}
+
+  template <class U>
+  recycling_allocator(recycling_allocator<U> const& other)
+    : slot(other.slot) {}
+
+  auto allocate(std::size_t n) -> T* {
+    auto const size = n * sizeof(T);
+    if (slot->block && slot->size == size) {
+      return static_cast<T*>(std::exchange(slot->block, nullptr));
+    }
+    ++slot->allocations;
+    return static_cast<T*>(::operator new(size));
+  }
+
+  void deallocate(T* ptr, std::size_t n) {
+    if (slot->block) {
+      ::operator delete(ptr);
+    } else {
+      slot->block = ptr;
+      slot->size = n * sizeof(T);
+    }
+  }
+
+  friend auto operator==(recycling_allocator l, recycling_allocator r)
+    -> bool {
+    return l.slot == r.slot;
+  }
+
+  friend auto operator!=(recycling_allocator l, recycling_allocator r)
+    -> bool {
+    return !(l == r);
+  }
+
+  recycling_slot* slot;
+};
+
+
+using chained_handler = xaos::completion_handler<
+  void(int),
+  boost::asio::system_executor,
+  recycling_allocator<void>>;
+
+// Starts the next operation of a chain from its completion.
+struct chain_step {
+  using allocator_type = recycling_allocator<int>;
+
+  auto get_allocator() const -> allocator_type { return alloc; }
+
+  void operator()(int remaining) {
+    ++*completed;
+    if (remaining) {
+      pending->emplace_back(chained_handler(*this), remaining - 1);
+    }
+  }
+
+  allocator_type alloc;
+  std::deque<std::pair<chained_handler, int>>* pending;
+  int* completed;
+};
+
+
+} // namespace
+
+
+int main() {
+  // test the associated allocator is used and exported
+  {
+    auto stats = std::make_shared<allocation_stats>();
+    auto result = 0;
+    {
+      auto h = xaos::make_completion_handler<void(int)>(
+        allocating_handler{counting_allocator<int>(stats), &result});
+      static_assert(std::is_same<
+                    decltype(h)::allocator_type,
+                    counting_allocator<void>>::value);
+      BOOST_TEST_EQ(stats->allocations, 1);
+
+      auto const alloc = boost::asio::get_associated_allocator(h);
+      BOOST_TEST(alloc == counting_allocator<void>(stats));
+
+      BOOST_TEST(h);
+      std::move(h)(3);
+      BOOST_TEST(!h);
+      BOOST_TEST_EQ(result, 3);
+      BOOST_TEST_EQ(stats->live, 0);
+    }
+    BOOST_TEST_EQ(stats->allocations, 1);
+  }
+
+  // test the associated executor is exported
+  {
+    auto ctx = boost::asio::io_context();
+    auto result = 0;
+    auto h = xaos::make_completion_handler<void()>(boost::asio::bind_executor(
+      ctx.get_executor(), [&] { result = 5; }));
+    BOOST_TEST(boost::asio::get_associated_executor(h) == ctx.get_executor());
+
+    // runs on the associated executor of the handler
+    boost::asio::post(std::move(h));
+    BOOST_TEST_EQ(result, 0);
+    ctx.run();
+    BOOST_TEST_EQ(result, 5);
+  }
+
+  // test the fallback executor
+  {
+    auto ctx = boost::asio::io_context();
+    auto result = 0;
+    auto h = xaos::completion_handler<
+      void(int),
+      boost::asio::io_context::executor_type>(
+      [&](int x) { result = x; }, ctx.get_executor());
+    BOOST_TEST(h.get_executor() == ctx.get_executor());
+
+    boost::asio::post(h.get_executor(), [&] { std::move(h)(7); });
+    ctx.run();
+    BOOST_TEST_EQ(result, 7);
+
+    auto g = xaos::completion_handler<void()>([] {});
+    BOOST_TEST(g.get_executor() == boost::asio::system_executor());
+    std::move(g)();
+  }
+
+  // test the backend is freed before the handler is invoked, so that the
+  // operation it starts reuses the memory
+  {
+    auto slot = recycling_slot();
+    auto pending = std::deque<std::pair<chained_handler, int>>();
+    auto completed = 0;
+    pending.emplace_back(
+      chained_handler(chain_step{slot, &pending, &completed}), 2);
+    BOOST_TEST_EQ(slot.allocations, 1);
+
+    while (!pending.empty()) {
+      auto op = std::move(pending.front());
+      pending.pop_front();
+      std::move(op.first)(op.second);
+      BOOST_TEST_EQ(slot.allocations, 1);
+    }
+    BOOST_TEST_EQ(completed, 3);
+  }
+
+  return boost::report_errors();
+}
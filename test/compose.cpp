@@ -0,0 +1,102 @@
+#include <xaos/compose.hpp>
+#include <xaos/function.hpp>
+
+#include <boost/core/lightweight_test.hpp>
+
+#include <memory>
+#include <string>
+
+#include "counting_allocator.hpp"
+
+
+namespace {
+
+
+struct ref_kind {
+  auto operator()(int) & -> std::string { return "&"; }
+  auto operator()(int) const& -> std::string { return "const&"; }
+  auto operator()(int) && -> std::string { return "&&"; }
+  auto operator()(int) const&& -> std::string { return "const&&"; }
+};
+
+
+auto twice(int n) { return n * 2; }
+
+
+} // namespace
+
+
+int main() {
+  auto const inc = [](int n) { return n + 1; };
+  auto const square = [](int n) { return n * n; };
+
+  // test then
+  BOOST_TEST_EQ(xaos::then(inc, square)(2), 9);
+  BOOST_TEST_EQ(xaos::then(inc, square).then(twice)(2), 18);
+
+  // test compose
+  BOOST_TEST_EQ(xaos::compose(inc)(2), 3);
+  BOOST_TEST_EQ(xaos::compose(inc, square)(2), 5);
+  BOOST_TEST_EQ(xaos::compose(twice, inc, square)(2), 10);
+
+  // test bind_front
+  {
+    auto const add = [](int a, int b, int c) { return a * 100 + b * 10 + c; };
+    BOOST_TEST_EQ(xaos::bind_front(add, 1)(2, 3), 123);
+    BOOST_TEST_EQ(xaos::bind_front(add, 1, 2)(3), 123);
+    BOOST_TEST_EQ(xaos::bind_front(add, 1).bind_front(2)(3), 123);
+    BOOST_TEST_EQ(xaos::bind_front(add, 1, 2).then(inc)(3), 124);
+  }
+
+  // test that void stages are supported
+  {
+    int calls = 0;
+    auto f
+      = xaos::then([&calls](int) { ++calls; }, [&calls] { return calls; });
+    BOOST_TEST_EQ(f(5), 1);
+    BOOST_TEST_EQ(f(5), 2);
+  }
+
+  // test that the value category of a chain is forwarded to the stages
+  {
+    auto const f = xaos::then(ref_kind(), [](std::string s) { return s; });
+    BOOST_TEST_EQ(f(0), "const&");
+    auto g = f;
+    BOOST_TEST_EQ(g(0), "&");
+    BOOST_TEST_EQ(std::move(g)(0), "&&");
+    BOOST_TEST_EQ(std::move(f)(0), "const&&");
+  }
+
+  // test that a fused chain results in a single backend
+  {
+    auto stats = std::make_shared<allocation_stats>();
+    auto alloc = counting_allocator<void>(stats);
+    auto f = xaos::function<int(int), decltype(alloc)>(
+      xaos::then(inc, square).then(twice), alloc);
+    BOOST_TEST_EQ(stats->allocations, 1);
+    BOOST_TEST_EQ(f(2), 18);
+  }
+
+  // test composition of type-erased stages
+  {
+    auto f = xaos::function<int(int)>(inc);
+    auto g = xaos::function<int(int)>(f.then(square));
+    BOOST_TEST_EQ(g(2), 9);
+    BOOST_TEST_EQ(f(2), 3);
+
+    auto h = xaos::function<int(int)>(std::move(g).then(inc).then(twice));
+    BOOST_TEST_EQ(h(2), 20);
+
+    auto k = xaos::function<int(int)>(h.bind_front().then(inc));
+    BOOST_TEST_EQ(k(2), 21);
+  }
+
+  // test composition of rvalue functions
+  {
+    auto f = xaos::rfunction<int(int)>(inc);
+    auto g = xaos::rfunction<int(int)>(std::move(f).then(square));
+    BOOST_TEST_EQ(std::move(g)(3), 16);
+  }
+
+  return boost::report_errors();
+}
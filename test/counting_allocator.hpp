@@ -0,0 +1,60 @@
+#ifndef XAOS_TEST_COUNTING_ALLOCATOR_HPP
+#define XAOS_TEST_COUNTING_ALLOCATOR_HPP
+
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+
+namespace {
+
+
+struct allocation_stats {
+  int allocations = 0;
+  int live = 0;
+};
+
+
+// Counts allocations made through all of its copies and rebinds. Copies
+// compare equal if they share the statistics.
+template <class T>
+class counting_allocator
+{
+public:
+  using value_type = T;
+
+  counting_allocator(std::shared_ptr<allocation_stats> stats)
+    : stats(std::move(stats)) {}
+
+  template <class U>
+  counting_allocator(counting_allocator<U> const& other)
+    : stats(other.stats) {}
+
+  auto allocate(std::size_t n) -> T* {
+    ++stats->allocations;
+    ++stats->live;
+    return std::allocator<T>().allocate(n);
+  }
+
+  void deallocate(T* ptr, std::size_t n) {
+    --stats->live;
+    std::allocator<T>().deallocate(ptr, n);
+  }
+
+  friend auto operator==(counting_allocator l, counting_allocator r) -> bool {
+    return l.stats == r.stats;
+  }
+
+  friend auto operator!=(counting_allocator l, counting_allocator r) -> bool {
+    return !(l == r);
+  }
+
+  std::shared_ptr<allocation_stats> stats;
+};
+
+
+} // namespace
+
+
+#endif // XAOS_TEST_COUNTING_ALLOCATOR_HPP
@@ -0,0 +1,145 @@
+#include <xaos/detail/perfect_hash.hpp>
+#include <xaos/dispatch_table.hpp>
+
+#include <boost/core/lightweight_test.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+int main() {
+  // test perfect_hash
+  {
+    auto hashes = std::vector<std::uint64_t>();
+    for (std::uint64_t i = 0; i < 1000; ++i) { hashes.push_back(i * i * 7); }
+
+    auto h = xaos::detail::perfect_hash();
+    auto const slots = h.build(hashes);
+    auto sorted = slots;
+    std::sort(sorted.begin(), sorted.end());
+    BOOST_TEST(
+      std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end());
+    BOOST_TEST_EQ(sorted.back(), 999u);
+
+    auto mismatches = 0;
+    for (std::size_t i = 0; i < hashes.size(); ++i) {
+      mismatches += h(hashes[i]) != slots[i];
+    }
+    BOOST_TEST_EQ(mismatches, 0);
+
+    hashes.push_back(7);
+    BOOST_TEST_THROWS(h.build(hashes), std::invalid_argument);
+  }
+
+  // test directly indexed integer keys
+  {
+    auto table = xaos::dispatch_table<int, int(int)>{
+      {3, [](int n) { return n + 3; }},
+      {-1, [](int n) { return n - 1; }},
+      {7, [](int n) { return n * 7; }}};
+    BOOST_TEST_EQ(table.size(), 3u);
+    BOOST_TEST(table.contains(-1));
+    BOOST_TEST(!table.contains(0));
+    BOOST_TEST(!table.contains(8));
+    BOOST_TEST(!table.contains(-2));
+    BOOST_TEST(!table.find(100000));
+
+    BOOST_TEST_EQ((*table.find(3))(1), 4);
+    BOOST_TEST_EQ((*table.find(-1))(1), 0);
+    BOOST_TEST_EQ((*table.find(7))(2), 14);
+
+    // copies do not live in the arena of the table
+    auto copy = *table.find(3);
+    BOOST_TEST(copy.get_allocator() == xaos::arena_allocator<void>());
+    BOOST_TEST(
+      table.find(3)->get_allocator() != xaos::arena_allocator<void>());
+  }
+
+  // test sparse integer keys
+  {
+    auto table = xaos::dispatch_table<unsigned, int()>{
+      {1u, [] { return 1; }},
+      {1000000u, [] { return 2; }},
+      {4000000000u, [] { return 3; }}};
+    BOOST_TEST_EQ((*table.find(1u))(), 1);
+    BOOST_TEST_EQ((*table.find(1000000u))(), 2);
+    BOOST_TEST_EQ((*table.find(4000000000u))(), 3);
+    BOOST_TEST(!table.contains(2u));
+  }
+
+  // test string keys
+  {
+    auto entries = std::vector<
+      xaos::dispatch_table<std::string, std::size_t()>::entry_type>();
+    for (int i = 0; i < 500; ++i) {
+      auto key = "message-" + std::to_string(i);
+      auto const length = key.size() + i;
+      entries.emplace_back(std::move(key), [length] { return length; });
+    }
+    auto table = xaos::dispatch_table<std::string, std::size_t()>(entries);
+    BOOST_TEST_EQ(table.size(), 500u);
+
+    auto mismatches = 0;
+    for (int i = 0; i < 500; ++i) {
+      auto const key = "message-" + std::to_string(i);
+      auto const handler = table.find(key);
+      mismatches += !handler || (*handler)() != key.size() + i;
+    }
+    BOOST_TEST_EQ(mismatches, 0);
+    BOOST_TEST(!table.contains("message-500"));
+    BOOST_TEST(!table.contains(""));
+  }
+
+  // test empty tables and duplicate keys
+  {
+    using table_type = xaos::dispatch_table<std::string, void()>;
+    auto const empty = table_type(std::vector<table_type::entry_type>());
+    BOOST_TEST(empty.empty());
+    BOOST_TEST(!empty.contains("a"));
+
+    BOOST_TEST_THROWS(
+      (table_type{{"a", [] {}}, {"b", [] {}}, {"a", [] {}}}),
+      std::invalid_argument);
+    BOOST_TEST_THROWS(
+      (xaos::dispatch_table<int, void()>{{1, [] {}}, {1, [] {}}}),
+      std::invalid_argument);
+  }
+
+  // test keys with colliding hash values
+  {
+    struct first_letter_hash {
+      auto operator()(std::string const& s) const -> std::size_t {
+        return s.empty() ? 0 : static_cast<unsigned char>(s[0]);
+      }
+    };
+    using table_type
+      = xaos::dispatch_table<std::string, int(), first_letter_hash>;
+
+    auto table = table_type{
+      {"apple", [] { return 1; }},
+      {"banana", [] { return 2; }},
+      {"avocado", [] { return 3; }},
+      {"blueberry", [] { return 4; }},
+      {"cherry", [] { return 5; }}};
+    BOOST_TEST_EQ(table.size(), 5u);
+    BOOST_TEST_EQ((*table.find("apple"))(), 1);
+    BOOST_TEST_EQ((*table.find("banana"))(), 2);
+    BOOST_TEST_EQ((*table.find("avocado"))(), 3);
+    BOOST_TEST_EQ((*table.find("blueberry"))(), 4);
+    BOOST_TEST_EQ((*table.find("cherry"))(), 5);
+    BOOST_TEST(!table.contains("apricot"));
+    BOOST_TEST(!table.contains("date"));
+
+    // repeated keys are still told apart from colliding ones
+    BOOST_TEST_THROWS(
+      (table_type{{"apple", [] { return 1; }},
+                  {"avocado", [] { return 2; }},
+                  {"apple", [] { return 3; }}}),
+      std::invalid_argument);
+  }
+
+  return boost::report_errors();
+}
@@ -30,6 +30,15 @@ static_assert(
     boost::mp11::
       mp_list<int(int) &, int(int) const&, int(int) &&, int(int) const&&>>);
 
+static_assert(
+  std::is_same_v<
+    xaos::detail::signature_overloads<int(int) noexcept>,
+    boost::mp11::mp_list<
+      int(int) & noexcept,
+      int(int) const& noexcept,
+      int(int) && noexcept,
+      int(int) const&& noexcept>>);
+
 static_assert(
   xaos::detail::trait_for_ref_kind<xaos::function_traits, int&>::value);
 static_assert(
@@ -62,6 +71,26 @@ static_assert(std::is_copy_assignable_v<xaos::const_function<int()>>);
 static_assert(!std::is_copy_constructible_v<xaos::rfunction<int()>>);
 static_assert(!std::is_copy_assignable_v<xaos::rfunction<int()>>);
 
+static_assert(std::is_nothrow_move_constructible_v<xaos::function<int()>>);
+static_assert(std::is_nothrow_move_assignable_v<xaos::function<int()>>);
+static_assert(std::is_nothrow_swappable_v<xaos::function<int()>>);
+static_assert(std::is_nothrow_move_assignable_v<xaos::rfunction<int()>>);
+static_assert(std::is_nothrow_swappable_v<xaos::rfunction<int()>>);
+
+static_assert(
+  noexcept(std::declval<xaos::function<int(int) noexcept>&>()(1)));
+static_assert(!noexcept(std::declval<xaos::function<int(int)>&>()(1)));
+
 static_assert(xaos::detail::has_pointer_to<int*>::value);
 static_assert(xaos::detail::has_pointer_to<void**>::value);
 static_assert(!xaos::detail::has_pointer_to<simple_pointer>::value);
+
+static_assert(std::is_same_v<xaos::detail::bulk_argument<int>, int const>);
+static_assert(std::is_same_v<xaos::detail::bulk_argument<int&>, int>);
+static_assert(
+  std::is_same_v<xaos::detail::bulk_argument<int const&>, int const>);
+static_assert(std::is_same_v<
+              xaos::detail::bulk_output<void>,
+              xaos::detail::no_bulk_output>);
+static_assert(
+  std::is_same_v<xaos::detail::bulk_output<int>, xaos::span<int>>);
@@ -4,9 +4,12 @@
 
 #include <boost/core/lightweight_test.hpp>
 
+#include <cstdint>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <type_traits>
+#include <vector>
 
 
 namespace {
@@ -28,6 +31,29 @@ struct enable_all {
 };
 
 
+struct const_bulk_traits {
+  static constexpr bool is_copyable = true;
+  static constexpr bool const_lvalue_ref_call = true;
+  static constexpr bool bulk_call = true;
+};
+
+
+// results which cannot be stored in arrays
+struct unassignable {
+  auto operator=(unassignable const&) -> unassignable& = delete;
+};
+
+
+template <class F, class = void>
+struct has_invoke_bulk : std::false_type {};
+
+template <class F>
+struct has_invoke_bulk<
+  F,
+  std::void_t<decltype(std::declval<F&>().invoke_bulk(
+    std::declval<xaos::span<int const>>()))>> : std::true_type {};
+
+
 auto get_42() { return 42; }
 
 
@@ -126,6 +152,47 @@ auto counting_memory_resource::get_allocator() -> counting_allocator<void> {
 }
 
 
+// compares unequal across resources and is never propagated
+template <class T>
+class pinned_allocator
+{
+public:
+  using value_type = T;
+
+  explicit pinned_allocator(counting_memory_resource& res) : res_(&res) {}
+
+  template <class U>
+  pinned_allocator(pinned_allocator<U> other) : res_(other.res_) {}
+
+  auto allocate(std::size_t n) -> T* {
+    res_->max_allocated += n * sizeof(T);
+    res_->currently_allocated += n * sizeof(T);
+    return std::allocator<T>().allocate(n);
+  }
+
+  void deallocate(T* ptr, std::size_t n) {
+    res_->currently_allocated -= n * sizeof(T);
+    std::allocator<T>().deallocate(ptr, n);
+  }
+
+  template <class U>
+  auto operator==(pinned_allocator<U> other) const -> bool {
+    return res_ == other.res_;
+  }
+
+  template <class U>
+  auto operator!=(pinned_allocator<U> other) const -> bool {
+    return res_ != other.res_;
+  }
+
+private:
+  template <class>
+  friend class pinned_allocator;
+
+  counting_memory_resource* res_;
+};
+
+
 template <class T>
 class tracking_allocator
 {
@@ -160,6 +227,20 @@ private:
 };
 
 
+struct alignas(128) over_aligned {
+  auto operator()() const -> int { return value; }
+
+  int value;
+};
+
+
+template <class Function>
+auto address_of_backend(Function& f) -> std::uintptr_t {
+  auto& storage = xaos::detail::function_access::storage(f);
+  return reinterpret_cast<std::uintptr_t>(dynamic_cast<void*>(&*storage));
+}
+
+
 } // namespace
 
 
@@ -286,10 +367,13 @@ int main() {
       &f.get_allocator().memory_resource(),
       &h.get_allocator().memory_resource());
 
+    static_assert(std::is_nothrow_move_assignable_v<F>);
+    auto const allocated = mem_rs1.max_allocated;
     g = std::move(f);
     BOOST_TEST_EQ(
       &g.get_allocator().memory_resource(),
       &h.get_allocator().memory_resource());
+    BOOST_TEST_EQ(mem_rs1.max_allocated, allocated);
   }
 
   // test POCS
@@ -326,5 +410,251 @@ int main() {
       &f1.get_allocator().memory_resource());
   }
 
+  // test move assignment between allocators which are not propagated
+  {
+    auto mem_rs1 = counting_memory_resource();
+    auto mem_rs2 = counting_memory_resource();
+    using F = xaos::function<int(), pinned_allocator<void>>;
+    auto f = F([] { return 1; }, pinned_allocator<void>(mem_rs1));
+    auto g = F([] { return 2; }, pinned_allocator<void>(mem_rs2));
+    g = std::move(f);
+    BOOST_TEST(g.get_allocator() == pinned_allocator<void>(mem_rs2));
+    BOOST_TEST_EQ(g(), 1);
+    BOOST_TEST_EQ(mem_rs1.currently_allocated, 0);
+    BOOST_TEST_EQ(mem_rs2.currently_allocated, mem_rs2.max_allocated / 2);
+  }
+
+  // test thin handles
+  {
+    auto mem_rs1 = counting_memory_resource();
+    auto mem_rs2 = counting_memory_resource();
+    auto alloc1 = mem_rs1.get_allocator();
+    auto alloc2 = mem_rs2.get_allocator();
+
+    using F = xaos::thin_function<int(), decltype(alloc1)>;
+    static_assert(sizeof(F) == sizeof(void*));
+    {
+      auto f = F([] { return 1; }, alloc1);
+      auto g = F([] { return 2; }, alloc2);
+      BOOST_TEST_EQ(f(), 1);
+      BOOST_TEST_EQ(&f.get_allocator().memory_resource(), &mem_rs1);
+      BOOST_TEST_EQ(&g.get_allocator().memory_resource(), &mem_rs2);
+
+      auto h = f;
+      BOOST_TEST_EQ(h(), 1);
+      BOOST_TEST_EQ(&h.get_allocator().memory_resource(), &mem_rs1);
+
+      swap(f, g);
+      BOOST_TEST_EQ(f(), 2);
+      BOOST_TEST_EQ(&f.get_allocator().memory_resource(), &mem_rs2);
+      BOOST_TEST_EQ(&g.get_allocator().memory_resource(), &mem_rs1);
+
+      auto const allocated = mem_rs1.max_allocated + mem_rs2.max_allocated;
+      h = std::move(f);
+      BOOST_TEST_EQ(h(), 2);
+      BOOST_TEST_EQ(&h.get_allocator().memory_resource(), &mem_rs2);
+      BOOST_TEST_EQ(
+        mem_rs1.max_allocated + mem_rs2.max_allocated, allocated);
+
+      f = g;
+      BOOST_TEST_EQ(f(), 1);
+      BOOST_TEST_EQ(&f.get_allocator().memory_resource(), &mem_rs1);
+    }
+    BOOST_TEST_EQ(mem_rs1.currently_allocated, 0);
+    BOOST_TEST_EQ(mem_rs2.currently_allocated, 0);
+  }
+
+  // test uses-allocator construction of nested functions
+  {
+    auto mem_rs1 = counting_memory_resource();
+    auto mem_rs2 = counting_memory_resource();
+
+    using F = xaos::function<int(), counting_allocator<void>>;
+    {
+      auto inner = F([] { return 3; }, mem_rs2.get_allocator());
+      auto outer = F(std::move(inner), mem_rs1.get_allocator());
+      BOOST_TEST_EQ(outer(), 3);
+      BOOST_TEST_EQ(mem_rs2.currently_allocated, 0);
+
+      auto const allocated = mem_rs1.currently_allocated;
+      auto copy = outer;
+      BOOST_TEST_EQ(copy(), 3);
+      BOOST_TEST_EQ(mem_rs1.currently_allocated, 2 * allocated);
+      BOOST_TEST_EQ(mem_rs2.currently_allocated, 0);
+    }
+    BOOST_TEST_EQ(mem_rs1.currently_allocated, 0);
+  }
+
+  // test allocator-extended moves move rather than copy
+  {
+    auto mem_rs1 = counting_memory_resource();
+    auto mem_rs2 = counting_memory_resource();
+
+    using F = xaos::function<int(), counting_allocator<void>>;
+    {
+      auto f = F([] { return 5; }, mem_rs1.get_allocator());
+      auto const allocated = mem_rs1.currently_allocated;
+
+      // equal allocators, the backend is taken over
+      auto g = F(std::allocator_arg, mem_rs1.get_allocator(), std::move(f));
+      BOOST_TEST_EQ(g(), 5);
+      BOOST_TEST_EQ(mem_rs1.currently_allocated, allocated);
+      BOOST_TEST_EQ(mem_rs1.max_allocated, allocated);
+
+      // unequal allocators, the backend is moved into the other memory
+      auto h = F(std::allocator_arg, mem_rs2.get_allocator(), std::move(g));
+      BOOST_TEST_EQ(h(), 5);
+      BOOST_TEST_EQ(mem_rs1.currently_allocated, 0);
+      BOOST_TEST_EQ(mem_rs2.currently_allocated, allocated);
+    }
+    BOOST_TEST_EQ(mem_rs2.currently_allocated, 0);
+  }
+
+  // test consume on call
+  {
+    auto mem_rs = counting_memory_resource();
+    auto alloc = mem_rs.get_allocator();
+    auto state = std::make_shared<int>(5);
+
+    using F = xaos::consuming_rfunction<int(int), decltype(alloc)>;
+    auto f = F([state](int x) { return *state + x; }, alloc);
+    BOOST_TEST(f);
+    BOOST_TEST_EQ(state.use_count(), 2);
+    BOOST_TEST_EQ(std::move(f)(1), 6);
+    BOOST_TEST(!f);
+    BOOST_TEST_EQ(state.use_count(), 1);
+    BOOST_TEST_EQ(mem_rs.currently_allocated, 0);
+
+    f = F([](int) -> int { throw std::runtime_error("failed"); }, alloc);
+    BOOST_TEST_THROWS(std::move(f)(1), std::runtime_error);
+    BOOST_TEST(!f);
+    BOOST_TEST_EQ(mem_rs.currently_allocated, 0);
+
+    // ordinary rfunctions keep their callable
+    auto g = xaos::rfunction<int(int)>([state](int x) { return *state + x; });
+    BOOST_TEST_EQ(std::move(g)(2), 7);
+    BOOST_TEST(g);
+    BOOST_TEST_EQ(state.use_count(), 2);
+  }
+
+  // test isolated backends
+  {
+    auto mem_rs = counting_memory_resource();
+    auto alloc = mem_rs.get_allocator();
+
+    using F = xaos::isolated_function<int(), decltype(alloc)>;
+    auto f = F([n = 0]() mutable { return ++n; }, alloc);
+    BOOST_TEST_EQ(mem_rs.max_allocated % 64, 0);
+    BOOST_TEST_EQ(address_of_backend(f) % 64, 0u);
+    BOOST_TEST_EQ(f(), 1);
+
+    auto g = f;
+    BOOST_TEST_EQ(address_of_backend(g) % 64, 0u);
+    BOOST_TEST_EQ(g(), 2);
+  }
+
+  // test over-aligned callables
+  {
+    auto mem_rs1 = counting_memory_resource();
+    auto mem_rs2 = counting_memory_resource();
+
+    using F = xaos::function<int(), counting_allocator<void>>;
+    auto f = F(over_aligned{1}, mem_rs1.get_allocator());
+    auto g = F(over_aligned{2}, mem_rs2.get_allocator());
+    BOOST_TEST_EQ(address_of_backend(f) % alignof(over_aligned), 0u);
+
+    auto h = f;
+    BOOST_TEST_EQ(address_of_backend(h) % alignof(over_aligned), 0u);
+    BOOST_TEST_EQ(h(), 1);
+
+    // relocates both backends
+    swap(f, g);
+    BOOST_TEST_EQ(address_of_backend(f) % alignof(over_aligned), 0u);
+    BOOST_TEST_EQ(address_of_backend(g) % alignof(over_aligned), 0u);
+    BOOST_TEST_EQ(f(), 2);
+    BOOST_TEST_EQ(g(), 1);
+  }
+
+  // test noexcept signatures
+  {
+    auto f = xaos::function<int(int) noexcept>([](int n) noexcept {
+      return n + 1;
+    });
+    static_assert(noexcept(f(1)));
+    BOOST_TEST_EQ(f(1), 2);
+
+    auto const g
+      = xaos::const_function<int() noexcept>([]() noexcept { return 42; });
+    BOOST_TEST_EQ(g(), 42);
+
+    auto h = xaos::rfunction<int(int) noexcept>(std::move(f));
+    static_assert(noexcept(std::move(h)(1)));
+    BOOST_TEST_EQ(std::move(h)(2), 3);
+  }
+
+  // test bulk invocation
+  {
+    auto f
+      = xaos::bulk_function<float(float)>([](float x) { return x * 2; });
+    auto const in = std::vector<float>{1, 2, 3};
+    auto out = std::vector<float>(3);
+    f.invoke_bulk(in, out);
+    auto const expected = std::vector<float>{2, 4, 6};
+    BOOST_TEST_ALL_EQ(
+      out.begin(), out.end(), expected.begin(), expected.end());
+
+    auto const g = xaos::basic_function<int(int, int), const_bulk_traits>(
+      std::plus<>());
+    int const lhs[] = {1, 2};
+    int const rhs[] = {10, 20};
+    int sums[2] = {};
+    g.invoke_bulk(lhs, rhs, sums);
+    BOOST_TEST_EQ(sums[0], 11);
+    BOOST_TEST_EQ(sums[1], 22);
+  }
+
+  // test bulk invocation without result
+  {
+    int sum = 0;
+    auto f
+      = xaos::bulk_function<void(int const&)>([&sum](int x) { sum += x; });
+    auto const values = std::vector<int>{1, 2, 3};
+    f.invoke_bulk(values);
+    BOOST_TEST_EQ(sum, 6);
+
+    f.invoke_bulk(xaos::span<int const>(values).first(2));
+    BOOST_TEST_EQ(sum, 9);
+  }
+
+  // test arguments are passed by reference and forwarded
+  {
+    auto f = xaos::function<void(int&)>([](int& x) { ++x; });
+    auto x = 1;
+    f(x);
+    BOOST_TEST_EQ(x, 2);
+
+    auto g = xaos::function<int(std::unique_ptr<int>&&)>(
+      [](std::unique_ptr<int>&& p) { return *p; });
+    BOOST_TEST_EQ(g(std::make_unique<int>(3)), 3);
+
+    auto b = xaos::bulk_function<void(int&)>([](int& x) { ++x; });
+    int values[] = {1, 2};
+    b.invoke_bulk(values);
+    BOOST_TEST_EQ(values[0], 2);
+    BOOST_TEST_EQ(values[1], 3);
+  }
+
+  // test only functions with bulk slots can be invoked in bulk
+  {
+    static_assert(has_invoke_bulk<xaos::bulk_function<int(int)>>::value);
+    static_assert(!has_invoke_bulk<xaos::function<int(int)>>::value);
+    static_assert(
+      !has_invoke_bulk<xaos::bulk_function<unassignable(int)>>::value);
+
+    auto f = xaos::bulk_function<unassignable(int)>(
+      [](int) { return unassignable(); });
+    f(1);
+  }
+
   return boost::report_errors();
 }
@@ -0,0 +1,187 @@
+#include <xaos/future.hpp>
+
+#include <boost/core/lightweight_test.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "counting_allocator.hpp"
+
+
+int main() {
+  // test value set before get
+  {
+    auto p = xaos::promise<int>();
+    auto f = p.get_future();
+    BOOST_TEST(f.valid());
+    BOOST_TEST(!f.is_ready());
+    p.set_value(42);
+    BOOST_TEST(f.is_ready());
+    BOOST_TEST_EQ(f.get(), 42);
+    BOOST_TEST(!f.valid());
+  }
+
+  // test continuation attached before the value is set
+  {
+    auto p = xaos::promise<int>();
+    auto ran = false;
+    auto f = p.get_future()
+               .then([&](int x) {
+                 ran = true;
+                 return std::to_string(x);
+               })
+               .then([](std::string s) { return s + "!"; });
+    BOOST_TEST(!ran);
+    BOOST_TEST(!f.is_ready());
+    p.set_value(7);
+    BOOST_TEST(ran);
+    BOOST_TEST(f.is_ready());
+    BOOST_TEST_EQ(f.get(), "7!");
+  }
+
+  // test continuation attached after the value is set runs inline
+  {
+    auto p = xaos::promise<int>();
+    auto f = p.get_future();
+    p.set_value(1);
+    auto ran = false;
+    auto g = std::move(f).then([&](int x) {
+      ran = true;
+      return x + 1;
+    });
+    BOOST_TEST(ran);
+    BOOST_TEST_EQ(g.get(), 2);
+  }
+
+  // test void results
+  {
+    auto p = xaos::promise<void>();
+    auto count = 0;
+    auto f = p.get_future().then([&] { ++count; }).then([&] {
+      ++count;
+      return count;
+    });
+    p.set_value();
+    BOOST_TEST_EQ(f.get(), 2);
+
+    auto q = xaos::promise<void>();
+    auto g = q.get_future();
+    q.set_value();
+    g.get();
+  }
+
+  // test exceptions skip continuations
+  {
+    auto p = xaos::promise<int>();
+    auto ran = false;
+    auto f = p.get_future().then([&](int x) {
+      ran = true;
+      return x;
+    });
+    p.set_exception(std::make_exception_ptr(std::runtime_error("failed")));
+    BOOST_TEST(!ran);
+    BOOST_TEST_THROWS(f.get(), std::runtime_error);
+  }
+
+  // test exceptions thrown by continuations
+  {
+    auto p = xaos::promise<int>();
+    auto f = p.get_future()
+               .then([](int) -> int { throw std::logic_error("bad"); })
+               .then([](int x) { return x; });
+    p.set_value(1);
+    BOOST_TEST_THROWS(f.get(), std::logic_error);
+  }
+
+  // test broken promise
+  {
+    auto f = xaos::future<int>();
+    {
+      auto p = xaos::promise<int>();
+      f = p.get_future();
+    }
+    BOOST_TEST(f.is_ready());
+    BOOST_TEST_THROWS(f.get(), std::future_error);
+  }
+
+  // test dropping futures and promises
+  {
+    auto p = xaos::promise<std::unique_ptr<int>>();
+    auto f = p.get_future().then([](std::unique_ptr<int> x) { return *x; });
+    f = {};
+    p.set_value(std::make_unique<int>(3));
+
+    auto q = xaos::promise<int>();
+    q.get_future();
+  }
+
+  // test one allocation per promise and per continuation
+  {
+    auto stats = std::make_shared<allocation_stats>();
+    auto alloc = counting_allocator<void>(stats);
+    {
+      auto p = xaos::promise<int, counting_allocator<void>>(alloc);
+      BOOST_TEST_EQ(stats->allocations, 1);
+      auto f = p.get_future()
+                 .then([big = std::string(100, 'x')](int x) {
+                   return x + static_cast<int>(big.size());
+                 })
+                 .then([](int x) { return x * 2; });
+      BOOST_TEST_EQ(stats->allocations, 3);
+      BOOST_TEST(f.get_allocator() == alloc);
+      p.set_value(1);
+      BOOST_TEST_EQ(f.get(), 202);
+    }
+    BOOST_TEST_EQ(stats->allocations, 3);
+    BOOST_TEST_EQ(stats->live, 0);
+  }
+
+  // test value set on another thread
+  {
+    for (int i = 0; i < 1000; ++i) {
+      auto p = xaos::promise<int>();
+      auto f = p.get_future().then([](int x) { return x + 1; });
+      auto t = std::thread([&p, i] { p.set_value(i); });
+      BOOST_TEST_EQ(f.get(), i + 1);
+      t.join();
+    }
+
+    for (int i = 0; i < 1000; ++i) {
+      auto p = xaos::promise<int>();
+      auto f = p.get_future();
+      auto t = std::thread([&p, i] { p.set_value(i); });
+      auto g = std::move(f).then([](int x) { return x * 2; });
+      BOOST_TEST_EQ(g.get(), i * 2);
+      t.join();
+    }
+  }
+
+  // test waiting threads block until the result is set
+  {
+    auto const count = 64;
+    auto promises = std::vector<xaos::promise<int>>(count);
+    auto futures = std::vector<xaos::future<int>>();
+    for (auto& p : promises) { futures.push_back(p.get_future()); }
+
+    auto sum = std::atomic<int>(0);
+    auto waiters = std::vector<std::thread>();
+    for (int t = 0; t != 4; ++t) {
+      waiters.emplace_back([&, t] {
+        for (int i = t; i < count; i += 4) { sum += futures[i].get(); }
+      });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    BOOST_TEST_EQ(sum.load(), 0);
+    for (int i = 0; i != count; ++i) { promises[i].set_value(i); }
+    for (auto& t : waiters) { t.join(); }
+    BOOST_TEST_EQ(sum.load(), count * (count - 1) / 2);
+  }
+
+  return boost::report_errors();
+}
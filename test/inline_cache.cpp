@@ -0,0 +1,103 @@
+#include <xaos/function.hpp>
+#include <xaos/inline_cache.hpp>
+
+#include <boost/core/lightweight_test.hpp>
+
+#include <string>
+
+
+namespace {
+
+
+struct add {
+  auto operator()(int x) -> int { return x + value; }
+
+  int value;
+};
+
+struct multiply {
+  auto operator()(int x) -> int { return x * value; }
+
+  int value;
+};
+
+struct by_ref_kind {
+  auto operator()() & -> std::string { return "&"; }
+  auto operator()() const& -> std::string { return "const&"; }
+};
+
+
+} // namespace
+
+
+int main() {
+  // test invoke_as
+  {
+    auto f = xaos::function<int(int)>(add{1});
+    BOOST_TEST_EQ(xaos::invoke_as<add>(f, 1), 2);
+    BOOST_TEST_EQ((xaos::invoke_as<multiply, add>(f, 2)), 3);
+    BOOST_TEST_EQ(xaos::invoke_as<multiply>(f, 3), 4);
+    BOOST_TEST_EQ(xaos::invoke_as<>(f, 4), 5);
+
+    // the callable is the one ordinary calls see
+    auto counter = 0;
+    auto count = [&counter](int x) { return counter += x; };
+    auto g = xaos::function<int(int)>(count);
+    BOOST_TEST_EQ(xaos::invoke_as<decltype(count)>(g, 2), 2);
+    BOOST_TEST_EQ(g(3), 5);
+    BOOST_TEST_EQ(counter, 5);
+  }
+
+  // test the called overload
+  {
+    auto f = xaos::function<std::string()>(by_ref_kind());
+    BOOST_TEST_EQ(xaos::invoke_as<by_ref_kind>(f), "&");
+
+    auto const g = xaos::const_function<std::string()>(by_ref_kind());
+    BOOST_TEST_EQ(xaos::invoke_as<by_ref_kind>(g), "const&");
+
+    auto cache = xaos::inline_cache<by_ref_kind>();
+    BOOST_TEST_EQ(cache(f), "&");
+    BOOST_TEST_EQ(cache(g), "const&");
+    BOOST_TEST_EQ(cache.hits(), 2u);
+  }
+
+  // test inline_cache
+  {
+    auto cache = xaos::inline_cache<add>();
+    BOOST_TEST_EQ(cache.hit_rate(), 0.0);
+
+    auto f = xaos::function<int(int)>(add{10});
+    auto g = xaos::function<int(int)>(multiply{10});
+    BOOST_TEST_EQ(cache(f, 1), 11);
+    BOOST_TEST_EQ(cache(f, 2), 12);
+    BOOST_TEST_EQ(cache(f, 3), 13);
+    BOOST_TEST_EQ(cache(g, 4), 40);
+    BOOST_TEST_EQ(cache.hits(), 3u);
+    BOOST_TEST_EQ(cache.misses(), 1u);
+    BOOST_TEST_EQ(cache.hit_rate(), 0.75);
+
+    cache.reset();
+    BOOST_TEST_EQ(cache.hits(), 0u);
+    BOOST_TEST_EQ(cache.misses(), 0u);
+  }
+
+  // test calls which throw are counted
+  {
+    auto thrower = [](int) -> int { throw 1; };
+    auto cache = xaos::inline_cache<decltype(thrower)>();
+    auto f = xaos::function<int(int)>(thrower);
+    BOOST_TEST_THROWS(cache(f, 1), int);
+    BOOST_TEST_EQ(cache.hits(), 1u);
+  }
+
+  // test allocators and thin handles
+  {
+    auto f = xaos::thin_function<int(int)>(multiply{3});
+    auto cache = xaos::inline_cache<add, multiply>();
+    BOOST_TEST_EQ(cache(f, 3), 9);
+    BOOST_TEST_EQ(cache.hits(), 1u);
+  }
+
+  return boost::report_errors();
+}
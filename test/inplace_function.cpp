@@ -0,0 +1,154 @@
+#include <xaos/inplace_function.hpp>
+
+#include <boost/core/lightweight_test.hpp>
+
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace {
+
+
+struct by_ref_kind {
+  auto operator()() & -> std::string { return "&"; }
+  auto operator()() const& -> std::string { return "const&"; }
+  auto operator()() && -> std::string { return "&&"; }
+  auto operator()() const&& -> std::string { return "const&&"; }
+};
+
+
+struct counted {
+  counted(int& live) : live(&live) { ++live; }
+  counted(counted const& other) noexcept : live(other.live) { ++*live; }
+  ~counted() { --*live; }
+
+  auto operator()() const -> int { return *live; }
+
+  int* live;
+};
+
+
+} // namespace
+
+
+int main() {
+  // test calls
+  {
+    auto f = xaos::inplace_function<int(int)>([](int x) { return x + 1; });
+    BOOST_TEST(f);
+    BOOST_TEST_EQ(f(1), 2);
+
+    auto const g = xaos::inplace_function<std::string(), 32>(by_ref_kind());
+    static_assert(!std::is_invocable<decltype(g)>::value);
+    auto h = xaos::inplace_function<std::string(), 32>(by_ref_kind());
+    BOOST_TEST_EQ(h(), "&");
+
+    auto cf = xaos::inplace_function<
+      std::string(),
+      32,
+      xaos::const_function_traits>(by_ref_kind());
+    BOOST_TEST_EQ(std::as_const(cf)(), "const&");
+
+    auto rf = xaos::inplace_function<
+      std::string(),
+      32,
+      xaos::rvalue_function_traits>(by_ref_kind());
+    BOOST_TEST_EQ(std::move(rf)(), "&&");
+  }
+
+  // test trivially copyable callables
+  {
+    auto const offset = 10;
+    auto f = xaos::inplace_function<int(int)>([offset](int x) {
+      return x + offset;
+    });
+    auto g = f;
+    BOOST_TEST_EQ(g(1), 11);
+
+    auto h = std::move(f);
+    BOOST_TEST(!f);
+    BOOST_TEST_EQ(h(2), 12);
+
+    f = h;
+    BOOST_TEST_EQ(f(3), 13);
+  }
+
+  // test lifetime of non-trivial callables
+  {
+    auto live = 0;
+    {
+      auto f = xaos::inplace_function<int(), 32>(counted(live));
+      BOOST_TEST_EQ(live, 1);
+      auto g = f;
+      BOOST_TEST_EQ(live, 2);
+      auto h = std::move(f);
+      BOOST_TEST_EQ(live, 2);
+      BOOST_TEST_EQ(h(), 2);
+
+      swap(g, h);
+      BOOST_TEST_EQ(live, 2);
+      h = g;
+      BOOST_TEST_EQ(live, 2);
+      f = std::move(g);
+      BOOST_TEST_EQ(live, 2);
+    }
+    BOOST_TEST_EQ(live, 0);
+  }
+
+  // test move-only callables
+  {
+    auto f = xaos::inplace_function<int(), 16, xaos::rvalue_function_traits>(
+      [p = std::make_unique<int>(4)] { return *p; });
+    static_assert(!std::is_copy_constructible<decltype(f)>::value);
+    auto g = std::move(f);
+    BOOST_TEST_EQ(std::move(g)(), 4);
+  }
+
+  // test consume on call
+  {
+    auto live = 0;
+    auto f = xaos::
+      inplace_function<int(), 32, xaos::consuming_rfunction_traits>(
+        counted(live));
+    BOOST_TEST_EQ(std::move(f)(), 1);
+    BOOST_TEST(!f);
+    BOOST_TEST_EQ(live, 0);
+  }
+
+  // test bulk invocation
+  {
+    using bulk_inplace_function = xaos::inplace_function<
+      int(int),
+      4 * sizeof(void*),
+      xaos::bulk_function_traits>;
+    auto f = bulk_inplace_function([](int x) { return x * 3; });
+    int const in[] = {1, 2, 3};
+    int out[3] = {};
+    f.invoke_bulk(in, out);
+    BOOST_TEST_EQ(out[0], 3);
+    BOOST_TEST_EQ(out[2], 9);
+  }
+
+  // test arguments are passed by reference
+  {
+    auto f = xaos::inplace_function<void(int&)>([](int& x) { x *= 3; });
+    auto x = 2;
+    f(x);
+    BOOST_TEST_EQ(x, 6);
+  }
+
+  // test storage in containers
+  {
+    auto v = std::vector<xaos::inplace_function<std::string(), 64>>();
+    for (int i = 0; i < 100; ++i) {
+      v.emplace_back([s = std::to_string(i)] { return s; });
+    }
+    BOOST_TEST_EQ(v[42](), "42");
+    static_assert(sizeof(v[0]) <= 64 + 2 * sizeof(void*));
+  }
+
+  return boost::report_errors();
+}
@@ -0,0 +1,111 @@
+#include <xaos/lazy.hpp>
+
+#include <boost/core/lightweight_test.hpp>
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "counting_allocator.hpp"
+
+
+namespace {
+
+
+struct no_default {
+  explicit no_default(int value) : value(value) {}
+  int value;
+};
+
+
+} // namespace
+
+
+int main() {
+  // test the producer is called once
+  {
+    auto calls = 0;
+    auto const value = xaos::lazy<std::string>([&] {
+      ++calls;
+      return std::string("value");
+    });
+    BOOST_TEST(!value.is_ready());
+    BOOST_TEST_EQ(calls, 0);
+
+    BOOST_TEST_EQ(*value, "value");
+    BOOST_TEST(value.is_ready());
+    BOOST_TEST_EQ(value->size(), 5u);
+    BOOST_TEST_EQ(&value.get(), &*value);
+    BOOST_TEST_EQ(calls, 1);
+  }
+
+  // test values that cannot be default constructed
+  {
+    auto value = xaos::lazy<no_default>([] { return no_default(3); });
+    value->value += 1;
+    BOOST_TEST_EQ(value.get().value, 4);
+  }
+
+  // test the producer is freed right after it is called
+  {
+    auto stats = std::make_shared<allocation_stats>();
+    auto const alloc = counting_allocator<void>(stats);
+    auto big = std::vector<int>(64, 1);
+    auto value = xaos::lazy<int, counting_allocator<void>>(
+      {[big = std::move(big)] { return static_cast<int>(big.size()); },
+       alloc});
+    BOOST_TEST(value.get_allocator() == alloc);
+    BOOST_TEST_EQ(stats->allocations, 1);
+    BOOST_TEST_EQ(stats->live, 1);
+
+    BOOST_TEST_EQ(value.get(), 64);
+    BOOST_TEST_EQ(stats->live, 0);
+    BOOST_TEST_EQ(value.get(), 64);
+    BOOST_TEST_EQ(stats->allocations, 1);
+  }
+
+  // test the producer is called again after it throws
+  {
+    auto calls = 0;
+    auto value = xaos::lazy<int>([&] {
+      if (++calls == 1) { throw std::runtime_error("first"); }
+      return calls;
+    });
+    BOOST_TEST_THROWS(value.get(), std::runtime_error);
+    BOOST_TEST(!value.is_ready());
+    BOOST_TEST_EQ(value.get(), 2);
+    BOOST_TEST_EQ(value.get(), 2);
+    BOOST_TEST_EQ(calls, 2);
+  }
+
+  // test concurrent first access calls the producer once
+  {
+    auto calls = std::atomic<int>(0);
+    auto start = std::atomic<bool>(false);
+    auto value = xaos::lazy<std::vector<int>>([&] {
+      ++calls;
+      std::this_thread::yield();
+      return std::vector<int>(100, 7);
+    });
+
+    auto results = std::vector<int>(8);
+    auto threads = std::vector<std::thread>();
+    for (auto& result : results) {
+      threads.emplace_back([&] {
+        while (!start.load()) { std::this_thread::yield(); }
+        for (auto const x : value.get()) { result += x; }
+      });
+    }
+    start = true;
+    for (auto& t : threads) { t.join(); }
+
+    BOOST_TEST_EQ(calls.load(), 1);
+    for (auto const result : results) { BOOST_TEST_EQ(result, 700); }
+  }
+
+  return boost::report_errors();
+}
@@ -0,0 +1,114 @@
+#include <xaos/function.hpp>
+
+#include <boost/core/lightweight_test.hpp>
+#include <boost/interprocess/allocators/allocator.hpp>
+#include <boost/interprocess/containers/vector.hpp>
+#include <boost/interprocess/managed_mapped_file.hpp>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <optional>
+#include <string>
+
+
+namespace {
+
+
+namespace ipc = boost::interprocess;
+
+using segment_manager = ipc::managed_mapped_file::segment_manager;
+
+template <class T>
+using segment_allocator = ipc::allocator<T, segment_manager>;
+
+using handler = xaos::function<int(int), segment_allocator<void>>;
+using handler_table = ipc::vector<handler, segment_allocator<handler>>;
+
+
+struct scale {
+  auto operator()(int x) const -> int { return x * factor; }
+  int factor;
+};
+
+struct offset {
+  auto operator()(int x) const -> int { return x + amount; }
+  int amount;
+  char padding[64] = {};
+};
+
+
+auto expected_sum(int n) -> int {
+  auto sum = 0;
+  for (int i = 0; i != n; ++i) { sum += i % 2 ? 3 * i : 3 + i; }
+  return sum;
+}
+
+auto sum_table(handler_table& table) -> int {
+  auto sum = 0;
+  for (auto& h : table) { sum += h(3); }
+  return sum;
+}
+
+
+} // namespace
+
+
+int main() {
+  auto const path = "xaos-mapped-file-" + std::to_string(::getpid());
+  auto const n = 100;
+  ipc::file_mapping::remove(path.c_str());
+
+  {
+    auto segment = std::optional<ipc::managed_mapped_file>();
+    segment.emplace(ipc::create_only, path.c_str(), 1 << 16);
+    auto const manager = segment->get_segment_manager();
+    auto const alloc = segment_allocator<void>(manager);
+    auto& table = *segment->construct<handler_table>("handlers")(alloc);
+    for (int i = 0; i != n; ++i) {
+      if (i % 2) {
+        table.push_back(handler(scale{i}, alloc));
+      } else {
+        table.push_back(handler(offset{i}, alloc));
+      }
+    }
+    BOOST_TEST_EQ(sum_table(table), expected_sum(n));
+    segment->flush();
+
+    auto const child = ::fork();
+    if (child == 0) {
+      // Maps the file a second time, at a different address, unmaps the
+      // original mapping and calls the table through the new one, which only
+      // works if the handles hold nothing but offset pointers.
+      auto status = 1;
+      {
+        auto again = ipc::managed_mapped_file(ipc::open_only, path.c_str());
+        auto const found = again.find<handler_table>("handlers").first;
+        auto const moved = found != &table;
+        segment.reset();
+        if (
+          found && moved && found->size() == std::size_t(n)
+          && sum_table(*found) == expected_sum(n)) {
+          status = 0;
+        }
+      }
+      ::_exit(status);
+    }
+
+    BOOST_TEST(child > 0);
+    auto status = 0;
+    BOOST_TEST_EQ(::waitpid(child, &status, 0), child);
+    BOOST_TEST(WIFEXITED(status));
+    BOOST_TEST_EQ(WEXITSTATUS(status), 0);
+    BOOST_TEST_EQ(sum_table(table), expected_sum(n));
+
+    auto const free_before = segment->get_free_memory();
+    table.erase(table.begin() + 1, table.end());
+    BOOST_TEST(segment->get_free_memory() > free_before);
+    segment->destroy<handler_table>("handlers");
+  }
+
+  ipc::file_mapping::remove(path.c_str());
+  return boost::report_errors();
+}
@@ -0,0 +1,112 @@
+#include <xaos/memoized_function.hpp>
+
+#include <boost/core/lightweight_test.hpp>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "counting_allocator.hpp"
+
+
+int main() {
+  // test that results are cached
+  {
+    int calls = 0;
+    auto f = xaos::memoized_function<int(int, int)>(
+      [&calls](int a, int b) {
+        ++calls;
+        return a * b;
+      },
+      4);
+
+    BOOST_TEST_EQ(f(2, 3), 6);
+    BOOST_TEST_EQ(f(2, 3), 6);
+    BOOST_TEST_EQ(f(3, 2), 6);
+    BOOST_TEST_EQ(calls, 2);
+    BOOST_TEST_EQ(f.hits(), 1u);
+    BOOST_TEST_EQ(f.misses(), 2u);
+    BOOST_TEST_EQ(f.size(), 2u);
+
+    f.clear();
+    BOOST_TEST_EQ(f.size(), 0u);
+    BOOST_TEST_EQ(f(2, 3), 6);
+    BOOST_TEST_EQ(calls, 3);
+  }
+
+  // test that the least recently used entry is evicted
+  {
+    int calls = 0;
+    auto f = xaos::memoized_function<std::string(std::string const&)>(
+      [&calls](std::string const& s) {
+        ++calls;
+        return s + s;
+      },
+      2);
+
+    BOOST_TEST_EQ(f("a"), "aa");
+    BOOST_TEST_EQ(f("b"), "bb");
+    BOOST_TEST_EQ(f("a"), "aa");
+    BOOST_TEST_EQ(calls, 2);
+
+    BOOST_TEST_EQ(f("c"), "cc");
+    BOOST_TEST_EQ(f.size(), 2u);
+    BOOST_TEST_EQ(calls, 3);
+
+    BOOST_TEST_EQ(f("a"), "aa");
+    BOOST_TEST_EQ(calls, 3);
+    BOOST_TEST_EQ(f("b"), "bb");
+    BOOST_TEST_EQ(calls, 4);
+  }
+
+  // test allocator support
+  {
+    auto stats = std::make_shared<allocation_stats>();
+    auto alloc = counting_allocator<void>(stats);
+    {
+      auto f = xaos::memoized_function<int(int), decltype(alloc)>(
+        [](int n) { return n; }, 8, alloc);
+      auto const before = stats->live;
+      f(1);
+      f(2);
+      BOOST_TEST_GT(stats->live, before);
+      BOOST_TEST(f.get_allocator() == alloc);
+    }
+    BOOST_TEST_EQ(stats->live, 0);
+  }
+
+  // test concurrent mode
+  {
+    auto f = xaos::concurrent_memoized_function<long(int)>(
+      [](int n) { return long(n) * n; }, 64);
+
+    auto mismatches = std::atomic<int>(0);
+    auto threads = std::vector<std::thread>();
+    for (int i = 0; i < 4; ++i) {
+      threads.emplace_back([&f, &mismatches] {
+        for (int n = 0; n < 1000; ++n) {
+          if (f(n % 32) != long(n % 32) * (n % 32)) { ++mismatches; }
+        }
+      });
+    }
+    for (auto& thread : threads) { thread.join(); }
+
+    BOOST_TEST_EQ(mismatches, 0);
+    BOOST_TEST_EQ(f.hits() + f.misses(), 4000u);
+    BOOST_TEST_GE(f.misses(), 32u);
+    BOOST_TEST_LE(f.size(), 64u);
+  }
+
+  // test a capacity below the shard count still bounds the cache
+  for (auto const capacity : {1u, 4u, 5u, 20u}) {
+    auto f = xaos::concurrent_memoized_function<int(int)>(
+      [](int n) { return n; }, capacity);
+    for (int n = 0; n < 100; ++n) { BOOST_TEST_EQ(f(n), n); }
+    BOOST_TEST_LE(f.size(), capacity);
+    BOOST_TEST_GE(f.size(), 1u);
+  }
+
+  return boost::report_errors();
+}
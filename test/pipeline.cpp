@@ -0,0 +1,141 @@
+#include <xaos/detail/spsc_queue.hpp>
+#include <xaos/pipeline.hpp>
+
+#include <boost/core/lightweight_test.hpp>
+
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+int main() {
+  // test spsc_queue
+  {
+    auto q = xaos::detail::spsc_queue<std::string, std::allocator<void>>(
+      5, std::allocator<void>());
+    BOOST_TEST_EQ(q.capacity(), 8u);
+    BOOST_TEST(q.empty());
+
+    BOOST_TEST(q.try_push(std::string("a")));
+    auto const in
+      = std::vector<std::string>{"b", "c", "d", "e", "f", "g", "h"};
+    BOOST_TEST_EQ(q.push_n(in.begin(), in.size()), 7u);
+    BOOST_TEST_EQ(q.size(), 8u);
+    BOOST_TEST(!q.try_push(std::string("i")));
+
+    auto out = std::vector<std::string>();
+    BOOST_TEST_EQ(q.pop_n(std::back_inserter(out), 3), 3u);
+    BOOST_TEST_EQ(out.size(), 3u);
+    BOOST_TEST_EQ(out[0], "a");
+    BOOST_TEST_EQ(out[2], "c");
+
+    // wraps around
+    BOOST_TEST_EQ(q.push_n(in.begin(), in.size()), 3u);
+    out.clear();
+    BOOST_TEST_EQ(q.pop_n(std::back_inserter(out), 100), 8u);
+    BOOST_TEST_EQ(out[0], "d");
+    BOOST_TEST_EQ(out[4], "h");
+    BOOST_TEST_EQ(out[5], "b");
+    BOOST_TEST_EQ(out[7], "d");
+    BOOST_TEST(q.empty());
+
+    // remaining elements are destroyed with the queue
+    BOOST_TEST(q.try_push(std::string(100, 'x')));
+  }
+
+  // test spsc_queue across threads
+  {
+    auto q = xaos::detail::spsc_queue<int, std::allocator<void>>(
+      16, std::allocator<void>());
+    int const count = 100000;
+    auto producer = std::thread([&] {
+      for (int i = 0; i < count;) {
+        if (q.try_push(i)) { ++i; }
+      }
+    });
+
+    auto out = std::vector<int>();
+    while (out.size() != std::size_t(count)) {
+      q.pop_n(std::back_inserter(out), 7);
+    }
+    producer.join();
+
+    auto mismatches = 0;
+    for (int i = 0; i < count; ++i) { mismatches += out[i] != i; }
+    BOOST_TEST_EQ(mismatches, 0);
+  }
+
+  // test pipeline
+  {
+    int const count = 100000;
+    auto results = std::vector<int>();
+
+    auto p = xaos::pipeline<int>(64, 16);
+    p.add_stage([](int& n) { n *= 2; })
+      .add_stage([](int& n) { n += 1; })
+      .add_stage([&](int& n) { results.push_back(n); });
+    BOOST_TEST_EQ(p.stage_count(), 3u);
+    BOOST_TEST_EQ(p.queue_capacity(0), 64u);
+
+    p.start();
+    for (int i = 0; i < count; ++i) { p.push(i); }
+    p.close();
+
+    BOOST_TEST_EQ(results.size(), std::size_t(count));
+    auto mismatches = 0;
+    for (int i = 0; i < count; ++i) { mismatches += results[i] != i * 2 + 1; }
+    BOOST_TEST_EQ(mismatches, 0);
+
+    for (std::size_t stage = 0; stage < p.stage_count(); ++stage) {
+      BOOST_TEST_EQ(p.processed(stage), std::uint64_t(count));
+      BOOST_TEST_EQ(p.queued(stage), 0u);
+    }
+  }
+
+  // test stages taking whole batches
+  {
+    auto batches = 0;
+    auto total = 0;
+    auto p = xaos::pipeline<std::unique_ptr<int>>(8, 4);
+    p.add_stage([](std::unique_ptr<int>& ptr) { ++*ptr; })
+      .add_stage([&](xaos::span<std::unique_ptr<int>> batch) {
+        BOOST_TEST(batch.size() <= 4u);
+        ++batches;
+        for (auto& ptr : batch) { total += *ptr; }
+      });
+    p.start();
+    for (int i = 0; i < 10; ++i) { p.push(std::make_unique<int>(i)); }
+    p.close();
+    BOOST_TEST_EQ(total, 55);
+    BOOST_TEST(batches >= 3);
+  }
+
+  // test stages stored in functions taking elements by reference
+  {
+    auto out = std::vector<std::string>();
+    auto p = xaos::pipeline<std::string>(8, 4);
+    p.add_stage(xaos::function<void(std::string&)>(
+                  [](std::string& s) { s += '!'; }))
+      .add_stage(
+        xaos::function<void(std::string&)>([&](std::string& s) {
+          out.push_back(s);
+        }));
+    p.start();
+    for (int i = 0; i < 6; ++i) { p.push(std::to_string(i)); }
+    p.close();
+    BOOST_TEST_EQ(out.size(), 6u);
+    BOOST_TEST_EQ(out.front(), "0!");
+    BOOST_TEST_EQ(out.back(), "5!");
+  }
+
+  // test a pipeline closed without elements
+  {
+    auto p = xaos::pipeline<std::string>();
+    p.add_stage([](std::string& s) { s += '!'; });
+    p.start();
+  }
+
+  return boost::report_errors();
+}
@@ -0,0 +1,235 @@
+#include <xaos/poly.hpp>
+
+#include <boost/core/lightweight_test.hpp>
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "counting_allocator.hpp"
+
+
+namespace {
+
+
+struct shape {
+  virtual auto area() const -> double = 0;
+  virtual void scale(double factor) = 0;
+
+  template <class Derived, class Base>
+  struct implementation : Base {
+    auto area() const -> double override {
+      return static_cast<Derived const&>(*this).value().area();
+    }
+
+    void scale(double factor) override {
+      static_cast<Derived&>(*this).value().scale(factor);
+    }
+  };
+
+protected:
+  ~shape() = default;
+};
+
+
+struct square {
+  auto area() const -> double { return side * side; }
+  void scale(double factor) { side *= factor; }
+
+  double side;
+};
+
+struct polygon {
+  auto area() const -> double { return area_; }
+  void scale(double factor) { area_ *= factor * factor; }
+
+  double area_;
+  double vertices[32] = {};
+};
+
+struct unique_square {
+  auto area() const -> double { return side->area(); }
+  void scale(double factor) { side->scale(factor); }
+
+  std::unique_ptr<square> side;
+};
+
+
+
+
+struct move_only_traits {};
+
+using shape_ptr = xaos::poly<shape>;
+using inline_shape = xaos::poly<shape, xaos::inline_poly_traits<>>;
+
+template <class Traits>
+using counted_shape = xaos::poly<shape, Traits, counting_allocator<void>>;
+
+
+} // namespace
+
+
+static_assert(std::is_copy_constructible<shape_ptr>::value);
+static_assert(!std::is_copy_constructible<
+              xaos::poly<shape, move_only_traits>>::value);
+static_assert(xaos::is_trivially_relocatable_v<shape_ptr>);
+static_assert(!xaos::is_trivially_relocatable_v<inline_shape>);
+
+
+int main() {
+  // test calls through the interface
+  {
+    auto s = shape_ptr(square{2});
+    BOOST_TEST(s);
+    BOOST_TEST_EQ(s->area(), 4.0);
+    s->scale(2);
+    BOOST_TEST_EQ((*s).area(), 16.0);
+    BOOST_TEST_EQ(std::as_const(s)->area(), 16.0);
+
+    auto t = shape_ptr(polygon{3});
+    s.swap(t);
+    BOOST_TEST_EQ(s->area(), 3.0);
+    BOOST_TEST_EQ(t->area(), 16.0);
+
+    auto u = std::move(s);
+    BOOST_TEST(!s);
+    BOOST_TEST_EQ(u->area(), 3.0);
+  }
+
+  // test copies are independent
+  {
+    auto s = shape_ptr(square{1});
+    auto t = s;
+    t->scale(3);
+    BOOST_TEST_EQ(s->area(), 1.0);
+    BOOST_TEST_EQ(t->area(), 9.0);
+
+    s = t;
+    BOOST_TEST_EQ(s->area(), 9.0);
+  }
+
+  // test move-only values
+  {
+    auto s = xaos::poly<shape, move_only_traits>(
+      unique_square{std::make_unique<square>(square{5})});
+    BOOST_TEST_EQ(s->area(), 25.0);
+    auto t = std::move(s);
+    BOOST_TEST_EQ(t->area(), 25.0);
+  }
+
+  // test one allocation per value
+  {
+    auto stats = std::make_shared<allocation_stats>();
+    auto alloc = counting_allocator<void>(stats);
+    {
+      auto s = counted_shape<xaos::poly_traits>(square{2}, alloc);
+      BOOST_TEST_EQ(stats->allocations, 1);
+      BOOST_TEST(s.get_allocator() == alloc);
+
+      auto t = s;
+      BOOST_TEST_EQ(stats->allocations, 2);
+
+      auto u = std::move(t);
+      BOOST_TEST_EQ(stats->allocations, 2);
+      BOOST_TEST_EQ(u->area(), 4.0);
+    }
+    BOOST_TEST_EQ(stats->live, 0);
+  }
+
+  // test small values are stored inline
+  {
+    auto stats = std::make_shared<allocation_stats>();
+    auto alloc = counting_allocator<void>(stats);
+    using inline_traits = xaos::inline_poly_traits<>;
+    {
+      auto s = counted_shape<inline_traits>(square{2}, alloc);
+      BOOST_TEST_EQ(stats->allocations, 0);
+
+      auto t = s;
+      t->scale(2);
+      auto u = std::move(t);
+      BOOST_TEST(!t);
+      BOOST_TEST_EQ(stats->allocations, 0);
+      BOOST_TEST_EQ(s->area(), 4.0);
+      BOOST_TEST_EQ(u->area(), 16.0);
+
+      // too large for the buffer
+      auto big = counted_shape<inline_traits>(polygon{7}, alloc);
+      BOOST_TEST_EQ(stats->allocations, 1);
+
+      s.swap(big);
+      BOOST_TEST_EQ(s->area(), 7.0);
+      BOOST_TEST_EQ(big->area(), 4.0);
+
+      u = s;
+      BOOST_TEST_EQ(stats->allocations, 2);
+      BOOST_TEST_EQ(u->area(), 7.0);
+    }
+    BOOST_TEST_EQ(stats->live, 0);
+  }
+
+  // test values that may throw on move are allocated
+  {
+    struct throwing_square : square {
+      throwing_square(double side) : square{side} {}
+      throwing_square(throwing_square const& other) : square(other) {}
+    };
+
+    auto stats = std::make_shared<allocation_stats>();
+    auto alloc = counting_allocator<void>(stats);
+    {
+      auto s = counted_shape<xaos::inline_poly_traits<>>(
+        throwing_square(3), alloc);
+      BOOST_TEST_EQ(stats->allocations, 1);
+      BOOST_TEST_EQ(s->area(), 9.0);
+    }
+    BOOST_TEST_EQ(stats->live, 0);
+  }
+
+  // test moves and reallocation between allocators
+  {
+    auto stats1 = std::make_shared<allocation_stats>();
+    auto stats2 = std::make_shared<allocation_stats>();
+    auto alloc1 = counting_allocator<void>(stats1);
+    auto alloc2 = counting_allocator<void>(stats2);
+    {
+      using heap_shape = counted_shape<xaos::poly_traits>;
+      auto s = heap_shape(square{2}, alloc1);
+      auto t = heap_shape(std::allocator_arg, alloc2, std::move(s));
+      BOOST_TEST(t.get_allocator() == alloc2);
+      BOOST_TEST_EQ(stats1->live, 0);
+      BOOST_TEST_EQ(stats2->live, 1);
+      BOOST_TEST_EQ(t->area(), 4.0);
+
+      t.reallocate(alloc1);
+      BOOST_TEST_EQ(stats1->live, 1);
+      BOOST_TEST_EQ(stats2->live, 0);
+      BOOST_TEST_EQ(t->area(), 4.0);
+
+      auto u = heap_shape(std::allocator_arg, alloc2, t);
+      BOOST_TEST_EQ(stats2->live, 1);
+      BOOST_TEST_EQ(u->area(), 4.0);
+
+      // the allocators do not propagate, so the value is relocated
+      u = std::move(t);
+      BOOST_TEST(!t);
+      BOOST_TEST(u.get_allocator() == alloc2);
+      BOOST_TEST_EQ(stats1->live, 0);
+      BOOST_TEST_EQ(stats2->live, 1);
+      BOOST_TEST_EQ(u->area(), 4.0);
+
+      using inline_traits = xaos::inline_poly_traits<>;
+      auto v = counted_shape<inline_traits>(square{3}, alloc1);
+      auto w = counted_shape<inline_traits>(polygon{5}, alloc2);
+      v.reallocate(alloc2);
+      BOOST_TEST(v.get_allocator() == alloc2);
+      v.swap(w);
+      BOOST_TEST_EQ(v->area(), 5.0);
+      BOOST_TEST_EQ(w->area(), 9.0);
+      BOOST_TEST_EQ(stats1->live, 0);
+    }
+    BOOST_TEST_EQ(stats2->live, 0);
+  }
+
+  return boost::report_errors();
+}
@@ -0,0 +1,152 @@
+#include <xaos/reclamation.hpp>
+
+#include <boost/core/lightweight_test.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+
+#include "counting_allocator.hpp"
+
+
+namespace {
+
+
+struct destruction_counter {
+  std::atomic<int>* destroyed;
+
+  destruction_counter(std::atomic<int>& destroyed) : destroyed(&destroyed) {}
+
+  destruction_counter(destruction_counter const& other)
+    : destroyed(other.destroyed) {}
+
+  ~destruction_counter() { ++(*destroyed); }
+
+  auto operator()() const -> int { return 1; }
+};
+
+
+// Constructed before the default queue, so destroyed after it. Backends left
+// in the queue must not be destroyed at exit, when the objects they refer to
+// may already be gone.
+std::atomic<int> destroyed_at_exit{0};
+
+struct exit_check {
+  ~exit_check() {
+    if (destroyed_at_exit.load()) { std::abort(); }
+  }
+} const check_at_exit;
+
+
+} // namespace
+
+
+static_assert(!xaos::detail::is_deferred_destruction_enabled<
+              xaos::function_traits>::value);
+static_assert(xaos::detail::is_deferred_destruction_enabled<
+              xaos::deferred_function_traits>::value);
+
+
+int main() {
+  xaos::collect();
+
+  // test that destruction is deferred until collection
+  {
+    auto destroyed = std::atomic<int>(0);
+    {
+      auto f = xaos::deferred_function<int()>(destruction_counter(destroyed));
+      BOOST_TEST_EQ(f(), 1);
+      destroyed = 0;
+    }
+    BOOST_TEST_EQ(destroyed, 0);
+    BOOST_TEST(!xaos::default_reclamation_queue().empty());
+
+    BOOST_TEST_EQ(xaos::collect(), 1u);
+    BOOST_TEST_EQ(destroyed, 1);
+    BOOST_TEST(xaos::default_reclamation_queue().empty());
+  }
+
+  // test that assignment defers destruction of the replaced backend
+  {
+    auto destroyed = std::atomic<int>(0);
+    {
+      auto f
+        = xaos::deferred_rfunction<int()>(destruction_counter(destroyed));
+      destroyed = 0;
+      f = [] { return 2; };
+      BOOST_TEST_EQ(destroyed, 0);
+      BOOST_TEST_EQ(std::move(f)(), 2);
+    }
+    BOOST_TEST_EQ(xaos::collect(), 2u);
+    BOOST_TEST_EQ(destroyed, 1);
+  }
+
+  // test that deferring allocates nothing and memory is returned to the
+  // right allocator
+  {
+    auto stats = std::make_shared<allocation_stats>();
+    auto alloc = counting_allocator<void>(stats);
+    {
+      using F = xaos::deferred_function<int(), decltype(alloc)>;
+      auto f = F([] { return 3; }, alloc);
+      auto g = f;
+      BOOST_TEST_EQ(g(), 3);
+      BOOST_TEST_EQ(stats->live, 2);
+    }
+    BOOST_TEST_EQ(stats->live, 2);
+    BOOST_TEST_EQ(xaos::collect(), 2u);
+    BOOST_TEST_EQ(stats->live, 0);
+  }
+
+  // test drain destroys backends handed over while collecting
+  {
+    auto destroyed = std::atomic<int>(0);
+    {
+      auto inner
+        = xaos::deferred_function<int()>(destruction_counter(destroyed));
+      auto outer = xaos::deferred_function<int()>(
+        [inner = std::move(inner)]() mutable { return inner(); });
+      destroyed = 0;
+    }
+    BOOST_TEST_EQ(xaos::drain(), 2u);
+    BOOST_TEST_EQ(destroyed, 1);
+    BOOST_TEST(xaos::default_reclamation_queue().empty());
+  }
+
+  // test collection on a background thread
+  {
+    auto destroyed = std::atomic<int>(0);
+    auto reclaimer = xaos::reclamation_thread(std::chrono::hours(1));
+    {
+      auto f = xaos::deferred_function<int()>(destruction_counter(destroyed));
+      destroyed = 0;
+    }
+    reclaimer.notify();
+    for (int i = 0; i < 1000 && !destroyed; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    BOOST_TEST_EQ(destroyed, 1);
+  }
+
+  // test a dedicated queue drained on destruction of the thread
+  {
+    auto queue = xaos::reclamation_queue();
+    {
+      auto reclaimer = xaos::reclamation_thread(std::chrono::hours(1), queue);
+    }
+    BOOST_TEST(queue.empty());
+  }
+
+  // test the default queue is left alone at exit. Everything else has been
+  // collected, so this backend is the only one leaked by the test.
+  BOOST_TEST(xaos::default_reclamation_queue().empty());
+  {
+    auto f
+      = xaos::deferred_function<int()>(destruction_counter(destroyed_at_exit));
+    destroyed_at_exit = 0;
+  }
+
+  return boost::report_errors();
+}
@@ -0,0 +1,215 @@
+#include <xaos/function.hpp>
+#include <xaos/relocate.hpp>
+
+#include <boost/core/lightweight_test.hpp>
+#include <boost/interprocess/allocators/allocator.hpp>
+#include <boost/interprocess/managed_heap_memory.hpp>
+#include <boost/interprocess/offset_ptr.hpp>
+
+#include <memory>
+#include <string>
+
+
+namespace {
+
+
+template <class T>
+class stateful_allocator
+{
+public:
+  using value_type = T;
+
+  stateful_allocator(std::shared_ptr<int> allocations)
+    : allocations(std::move(allocations)) {}
+
+  template <class U>
+  stateful_allocator(stateful_allocator<U> const& other)
+    : allocations(other.allocations) {}
+
+  auto allocate(std::size_t n) -> T* {
+    ++*allocations;
+    return std::allocator<T>().allocate(n);
+  }
+
+  void deallocate(T* ptr, std::size_t n) {
+    std::allocator<T>().deallocate(ptr, n);
+  }
+
+  friend auto operator==(stateful_allocator l, stateful_allocator r) -> bool {
+    return l.allocations == r.allocations;
+  }
+
+  friend auto operator!=(stateful_allocator l, stateful_allocator r) -> bool {
+    return !(l == r);
+  }
+
+  std::shared_ptr<int> allocations;
+};
+
+
+// A stateless, trivially copyable allocator with offset pointers.
+template <class T>
+class offset_allocator
+{
+public:
+  using value_type = T;
+  using pointer = boost::interprocess::offset_ptr<T>;
+  using void_pointer = boost::interprocess::offset_ptr<void>;
+
+  offset_allocator() = default;
+
+  template <class U>
+  offset_allocator(offset_allocator<U> const&) {}
+
+  auto allocate(std::size_t n) -> pointer {
+    return pointer(std::allocator<T>().allocate(n));
+  }
+
+  void deallocate(pointer ptr, std::size_t n) {
+    std::allocator<T>().deallocate(ptr.get(), n);
+  }
+
+  friend auto operator==(offset_allocator, offset_allocator) -> bool {
+    return true;
+  }
+
+  friend auto operator!=(offset_allocator, offset_allocator) -> bool {
+    return false;
+  }
+};
+
+
+using heap_allocator = boost::interprocess::allocator<
+  void,
+  boost::interprocess::managed_heap_memory::segment_manager>;
+
+
+template <class T>
+struct raw_storage {
+  explicit raw_storage(std::size_t n)
+    : ptr(std::allocator<T>().allocate(n)), capacity(n) {}
+
+  raw_storage(raw_storage const&) = delete;
+  auto operator=(raw_storage const&) -> raw_storage& = delete;
+
+  ~raw_storage() { std::allocator<T>().deallocate(ptr, capacity); }
+
+  T* ptr;
+  std::size_t capacity;
+};
+
+
+} // namespace
+
+
+static_assert(xaos::is_trivially_relocatable_v<int>);
+static_assert(!xaos::is_trivially_relocatable_v<std::string>);
+static_assert(xaos::is_trivially_relocatable_v<xaos::function<int()>>);
+static_assert(xaos::is_trivially_relocatable_v<xaos::rfunction<int()>>);
+static_assert(!xaos::is_trivially_relocatable_v<
+              xaos::function<int(), stateful_allocator<void>>>);
+static_assert(xaos::is_trivially_relocatable_v<
+              xaos::thin_function<int(), stateful_allocator<void>>>);
+// offset pointers would point elsewhere after being copied bytewise
+static_assert(std::is_trivially_copyable<offset_allocator<void>>::value);
+static_assert(!xaos::is_trivially_relocatable_v<
+              xaos::thin_function<int(), offset_allocator<void>>>);
+static_assert(!xaos::is_trivially_relocatable_v<
+              xaos::thin_function<int(), heap_allocator>>);
+
+
+int main() {
+  // test relocation of trivially relocatable handles
+  {
+    using F = xaos::function<int()>;
+    auto src = raw_storage<F>(4);
+    auto dst = raw_storage<F>(4);
+    for (int i = 0; i < 4; ++i) {
+      ::new (src.ptr + i) F([i] { return i; });
+    }
+
+    auto const end = xaos::relocate_n(src.ptr, 4, dst.ptr);
+    BOOST_TEST_EQ(end, dst.ptr + 4);
+    for (int i = 0; i < 4; ++i) { BOOST_TEST_EQ(dst.ptr[i](), i); }
+
+    // erase the first element by relocating the rest over it
+    dst.ptr[0].~F();
+    xaos::relocate_n(dst.ptr + 1, 3, dst.ptr);
+    for (int i = 0; i < 3; ++i) { BOOST_TEST_EQ(dst.ptr[i](), i + 1); }
+
+    for (int i = 0; i < 3; ++i) { dst.ptr[i].~F(); }
+  }
+
+  // test relocation falling back to move construction
+  {
+    using F = xaos::function<int(), stateful_allocator<void>>;
+    auto const allocations = std::make_shared<int>(0);
+    auto const alloc = stateful_allocator<void>(allocations);
+
+    auto src = raw_storage<F>(4);
+    auto dst = raw_storage<F>(4);
+    for (int i = 0; i < 4; ++i) {
+      ::new (src.ptr + i) F([i] { return i; }, alloc);
+    }
+    BOOST_TEST_EQ(*allocations, 4);
+
+    xaos::relocate_n(src.ptr, 4, dst.ptr);
+    BOOST_TEST_EQ(*allocations, 4);
+    for (int i = 0; i < 4; ++i) { BOOST_TEST_EQ(dst.ptr[i](), i); }
+
+    dst.ptr[0].~F();
+    xaos::relocate_n(dst.ptr + 1, 3, dst.ptr);
+    for (int i = 0; i < 3; ++i) { BOOST_TEST_EQ(dst.ptr[i](), i + 1); }
+
+    for (int i = 0; i < 3; ++i) { dst.ptr[i].~F(); }
+    BOOST_TEST_EQ(allocations.use_count(), 2);
+  }
+
+  // test relocation of handles holding offset pointers
+  {
+    auto memory = boost::interprocess::managed_heap_memory(1 << 16);
+    using F = xaos::thin_function<int(int), heap_allocator>;
+    auto const alloc = heap_allocator(memory.get_segment_manager());
+
+    auto src = raw_storage<F>(4);
+    auto dst = raw_storage<F>(4);
+    for (int i = 0; i < 4; ++i) {
+      ::new (src.ptr + i) F([i](int x) { return x + i; }, alloc);
+    }
+
+    xaos::relocate_n(src.ptr, 4, dst.ptr);
+    for (int i = 0; i < 4; ++i) { BOOST_TEST_EQ(dst.ptr[i](1), i + 1); }
+    for (int i = 0; i < 4; ++i) { dst.ptr[i].~F(); }
+    BOOST_TEST(memory.all_memory_deallocated());
+  }
+
+  {
+    using F = xaos::thin_function<int(int), offset_allocator<void>>;
+    auto src = raw_storage<F>(4);
+    auto dst = raw_storage<F>(4);
+    for (int i = 0; i < 4; ++i) {
+      ::new (src.ptr + i) F([i](int x) { return x * i; });
+    }
+
+    xaos::relocate_n(src.ptr, 4, dst.ptr);
+    for (int i = 0; i < 4; ++i) { BOOST_TEST_EQ(dst.ptr[i](2), 2 * i); }
+    for (int i = 0; i < 4; ++i) { dst.ptr[i].~F(); }
+  }
+
+  // test relocation of other types
+  {
+    auto src = raw_storage<std::string>(4);
+    auto dst = raw_storage<std::string>(4);
+    ::new (src.ptr) std::string(100, 'a');
+    ::new (src.ptr + 1) std::string("b");
+
+    xaos::relocate_n(src.ptr, 2, dst.ptr);
+    BOOST_TEST_EQ(dst.ptr[0], std::string(100, 'a'));
+    BOOST_TEST_EQ(dst.ptr[1], "b");
+
+    dst.ptr[0].~basic_string();
+    dst.ptr[1].~basic_string();
+  }
+
+  return boost::report_errors();
+}
@@ -0,0 +1,96 @@
+#include <xaos/strand.hpp>
+
+#include <boost/core/lightweight_test.hpp>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+int main() {
+  // test that tasks run inline when the strand is idle
+  {
+    auto s = xaos::strand<>();
+    int calls = 0;
+    s.post([&] {
+      ++calls;
+      BOOST_TEST(s.running_in_this_thread());
+    });
+    BOOST_TEST_EQ(calls, 1);
+    BOOST_TEST(!s.running_in_this_thread());
+  }
+
+  // test that tasks posted from a running task are deferred, not nested
+  {
+    auto s = xaos::strand<>();
+    auto order = std::vector<int>();
+    s.post([&] {
+      s.post([&] { order.push_back(2); });
+      order.push_back(1);
+    });
+    auto const expected = std::vector<int>{1, 2};
+    BOOST_TEST_ALL_EQ(
+      order.begin(), order.end(), expected.begin(), expected.end());
+  }
+
+  // test that a throwing task releases the strand
+  {
+    auto s = xaos::strand<>();
+    int calls = 0;
+    BOOST_TEST_THROWS(
+      s.post([&] {
+        s.post([&] { ++calls; });
+        throw 1;
+      }),
+      int);
+    BOOST_TEST_EQ(calls, 0);
+    BOOST_TEST_EQ(s.poll(), 1u);
+    BOOST_TEST_EQ(calls, 1);
+  }
+
+  // test that pending tasks are destroyed with the strand
+  {
+    auto counter = std::make_shared<int>();
+    {
+      auto s = xaos::strand<>();
+      try {
+        s.post([&s, counter] {
+          s.post([counter] {});
+          throw 1;
+        });
+      } catch (int) {
+      }
+      BOOST_TEST_EQ(counter.use_count(), 2);
+    }
+    BOOST_TEST_EQ(counter.use_count(), 1);
+  }
+
+  // test serialization of tasks posted from several threads
+  {
+    auto s = xaos::strand<>();
+    auto inside = std::atomic<int>(0);
+    auto overlaps = std::atomic<int>(0);
+    long counter = 0;
+
+    auto threads = std::vector<std::thread>();
+    for (int i = 0; i < 4; ++i) {
+      threads.emplace_back([&] {
+        for (int n = 0; n < 20000; ++n) {
+          s.post([&] {
+            if (inside.fetch_add(1) != 0) { ++overlaps; }
+            ++counter;
+            inside.fetch_sub(1);
+          });
+        }
+      });
+    }
+    for (auto& thread : threads) { thread.join(); }
+    s.poll();
+
+    BOOST_TEST_EQ(overlaps, 0);
+    BOOST_TEST_EQ(counter, 80000);
+  }
+
+  return boost::report_errors();
+}
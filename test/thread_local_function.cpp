@@ -0,0 +1,108 @@
+#include <xaos/thread_local_function.hpp>
+
+#include <boost/core/lightweight_test.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+int main() {
+  // test replicas per thread
+  {
+    auto f = xaos::thread_local_function<int()>(
+      [n = 0]() mutable { return ++n; });
+    BOOST_TEST_EQ(f.replica_count(), 0u);
+
+    BOOST_TEST_EQ(f(), 1);
+    BOOST_TEST_EQ(f(), 2);
+    BOOST_TEST_EQ(f.replica_count(), 1u);
+
+    auto const threads = 4;
+    auto const calls = 10000;
+    auto results = std::vector<int>(threads);
+    auto workers = std::vector<std::thread>();
+    for (int i = 0; i < threads; ++i) {
+      workers.emplace_back([&, i] {
+        auto last = 0;
+        for (int j = 0; j < calls; ++j) { last = f(); }
+        results[i] = last;
+      });
+    }
+    for (auto& worker : workers) { worker.join(); }
+
+    // each thread counted on its own replica
+    for (auto const result : results) { BOOST_TEST_EQ(result, calls); }
+    BOOST_TEST_EQ(f.replica_count(), threads + 1u);
+    BOOST_TEST_EQ(f(), 3);
+
+    auto total = 0;
+    f.for_each_replica([&](auto& replica) { total += replica() - 1; });
+    BOOST_TEST_EQ(total, threads * calls + 3);
+  }
+
+  // test several thread_local_functions on one thread
+  {
+    auto f = xaos::thread_local_function<int(int)>(
+      [sum = 0](int x) mutable { return sum += x; });
+    auto g = xaos::thread_local_function<int(int)>(
+      [product = 1](int x) mutable { return product *= x; });
+    for (int i = 1; i <= 4; ++i) {
+      f(i);
+      g(i);
+    }
+    BOOST_TEST_EQ(f(0), 10);
+    BOOST_TEST_EQ(g(1), 24);
+    BOOST_TEST_EQ(&f.local(), &f.local());
+  }
+
+  // test a new function does not reuse the replica of a destroyed one
+  {
+    for (int i = 0; i < 3; ++i) {
+      auto f = xaos::thread_local_function<int()>([i] { return i; });
+      BOOST_TEST_EQ(f(), i);
+    }
+  }
+
+  // test entries of destroyed functions are erased from all threads
+  {
+    auto& replicas = xaos::detail::thread_replicas();
+    auto const before = replicas.size();
+
+    auto go = false;
+    auto done = false;
+    auto mutex = std::mutex();
+    auto cv = std::condition_variable();
+    auto other_size = std::size_t(0);
+    auto other = std::thread();
+    {
+      auto f = xaos::thread_local_function<int()>([] { return 1; });
+      f();
+      BOOST_TEST_EQ(replicas.size(), before + 1);
+
+      other = std::thread([&] {
+        f();
+        auto lock = std::unique_lock<std::mutex>(mutex);
+        done = true;
+        cv.notify_all();
+        cv.wait(lock, [&] { return go; });
+        other_size = xaos::detail::thread_replicas().size();
+      });
+      auto lock = std::unique_lock<std::mutex>(mutex);
+      cv.wait(lock, [&] { return done; });
+    }
+    BOOST_TEST_EQ(replicas.size(), before);
+
+    {
+      auto lock = std::lock_guard<std::mutex>(mutex);
+      go = true;
+    }
+    cv.notify_all();
+    other.join();
+    BOOST_TEST_EQ(other_size, 0u);
+  }
+
+  return boost::report_errors();
+}
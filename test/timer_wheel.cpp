@@ -0,0 +1,143 @@
+#include <xaos/timer_wheel.hpp>
+
+#include <boost/core/lightweight_test.hpp>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "counting_allocator.hpp"
+
+
+int main() {
+  // test that timers fire at their deadlines
+  {
+    auto wheel = xaos::timer_wheel<>();
+    auto fired = std::vector<int>();
+    wheel.schedule(3, [&] { fired.push_back(3); });
+    wheel.schedule(1, [&] { fired.push_back(1); });
+    wheel.schedule(0, [&] { fired.push_back(0); });
+    wheel.schedule(2, [&] { fired.push_back(2); });
+    BOOST_TEST_EQ(wheel.size(), 4u);
+
+    BOOST_TEST_EQ(wheel.advance(), 2u);
+    BOOST_TEST_EQ(fired.size(), 2u);
+    BOOST_TEST_EQ(wheel.advance(2), 2u);
+    BOOST_TEST_EQ(wheel.now(), 3u);
+    BOOST_TEST(wheel.empty());
+
+    auto const expected = std::vector<int>{1, 0, 2, 3};
+    BOOST_TEST_ALL_EQ(
+      fired.begin(), fired.end(), expected.begin(), expected.end());
+  }
+
+  // test cancellation
+  {
+    auto wheel = xaos::timer_wheel<>();
+    int fired = 0;
+    auto const a = wheel.schedule(5, [&] { fired += 1; });
+    auto const b = wheel.schedule(5000, [&] { fired += 10; });
+    wheel.schedule(5, [&] { fired += 100; });
+
+    BOOST_TEST(wheel.cancel(a));
+    BOOST_TEST(!wheel.cancel(a));
+    BOOST_TEST(wheel.cancel(b));
+    BOOST_TEST(!wheel.cancel(decltype(wheel)::timer_id()));
+    BOOST_TEST_EQ(wheel.size(), 1u);
+
+    wheel.advance(10000);
+    BOOST_TEST_EQ(fired, 100);
+
+    // a recycled node does not match an old id
+    auto const c = wheel.schedule(1, [] {});
+    BOOST_TEST(!wheel.cancel(a));
+    BOOST_TEST(wheel.cancel(c));
+  }
+
+  // test that timers cascading from higher levels fire exactly on time
+  {
+    auto wheel = xaos::timer_wheel<>();
+    auto rng = std::mt19937(42);
+    auto delays = std::uniform_int_distribution<std::uint64_t>(1, 300000);
+
+    int late = 0;
+    int fired = 0;
+    for (int i = 0; i < 10000; ++i) {
+      auto const deadline = wheel.now() + delays(rng);
+      wheel.schedule(deadline - wheel.now(), [&, deadline] {
+        ++fired;
+        if (wheel.now() != deadline) { ++late; }
+      });
+      wheel.advance(i % 7);
+    }
+    wheel.advance(400000);
+    BOOST_TEST_EQ(fired, 10000);
+    BOOST_TEST_EQ(late, 0);
+  }
+
+  // test timers far beyond the range of the wheel
+  {
+    auto wheel = xaos::timer_wheel<>();
+    auto const deadline = (std::uint64_t(1) << 36) + 5;
+    int fired = 0;
+    wheel.schedule(deadline, [&] { ++fired; });
+    wheel.schedule(0, [&] { ++fired; });
+    for (std::uint64_t t = 0; t < deadline;) {
+      wheel.advance(1 << 20);
+      t += 1 << 20;
+      if (t >= deadline) { break; }
+      BOOST_TEST_LE(fired, 1);
+    }
+    BOOST_TEST_EQ(fired, 2);
+  }
+
+  // test rescheduling from a callback
+  {
+    auto wheel = xaos::timer_wheel<>();
+    int fired = 0;
+    struct periodic {
+      xaos::timer_wheel<>& wheel;
+      int& fired;
+      void operator()() {
+        if (++fired < 5) { wheel.schedule(10, periodic{wheel, fired}); }
+      }
+    };
+    wheel.schedule(10, periodic{wheel, fired});
+    wheel.advance(100);
+    BOOST_TEST_EQ(fired, 5);
+  }
+
+  // test that an exception does not lose expired timers
+  {
+    auto wheel = xaos::timer_wheel<>();
+    int fired = 0;
+    wheel.schedule(1, [] { throw 1; });
+    wheel.schedule(1, [&] { ++fired; });
+    BOOST_TEST_THROWS(wheel.advance(), int);
+    BOOST_TEST_EQ(fired, 0);
+    BOOST_TEST_EQ(wheel.advance(0), 1u);
+    BOOST_TEST_EQ(fired, 1);
+  }
+
+  // test allocator support
+  {
+    auto stats = std::make_shared<allocation_stats>();
+    {
+      auto alloc = counting_allocator<void>(stats);
+      auto wheel = xaos::timer_wheel<decltype(alloc)>(alloc);
+      auto const id = wheel.schedule(5, [] {});
+      BOOST_TEST_EQ(stats->live, 2);
+      wheel.cancel(id);
+      BOOST_TEST_EQ(stats->live, 1);
+
+      // nodes are reused
+      wheel.schedule(5, [] {});
+      wheel.schedule(8, [] {});
+      BOOST_TEST_EQ(stats->live, 4);
+      BOOST_TEST(wheel.get_allocator() == alloc);
+    }
+    BOOST_TEST_EQ(stats->live, 0);
+  }
+
+  return boost::report_errors();
+}